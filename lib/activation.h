@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cmath>
+#include <algorithm>
+
+namespace NN {
+
+    enum class ActivationType { Sigmoid = 's', Tanh = 't', ReLU = 'r', LeakyReLU = 'l' };
+
+    // Shared by every layer kind (dense, conv, ...), so they all agree on f(x) and f'(x)
+    inline float activate(ActivationType type, float x) {
+        switch (type) {
+            case ActivationType::Tanh: return std::tanh(x);
+            case ActivationType::Sigmoid: return 1.0f / (1.0f + std::exp(-x));
+            case ActivationType::ReLU: return std::max(0.0f, x);
+            case ActivationType::LeakyReLU: return (x > 0) ? x : 0.01f * x;
+            default: return x;
+        }
+    }
+
+    // Calculates f'(x). Note: We pass the ACTIVATED value (y), not x, for efficiency
+    inline float activateDerivative(ActivationType type, float y) {
+        switch (type) {
+            case ActivationType::Tanh:
+                return 1.0f - (y * y); // d/dx tanh(x) = 1 - tanh^2(x)
+            case ActivationType::Sigmoid:
+                return y * (1.0f - y); // d/dx sig(x) = sig(x)(1 - sig(x))
+            case ActivationType::ReLU:
+                return (y > 0.0f) ? 1.0f : 0.0f;
+            case ActivationType::LeakyReLU:
+                return (y > 0.0f) ? 1.0f : 0.01f;
+            default: return 1.0f;
+        }
+    }
+}
@@ -0,0 +1,345 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <atomic>
+#include <algorithm>
+#include <iostream>
+#include <cstring>
+#include <cstdlib>
+#include <cstdint>
+#include <cerrno>
+
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace NN {
+
+    // One piece of a gather: `length` bytes at `offset` in file `file`, copied to `dest`
+    struct ReadRequest {
+        uint64_t offset = 0;
+        uint32_t length = 0;
+        void* dest = nullptr;
+        uint32_t file = 0; // index returned by AsyncReader::addFile (0 after open)
+    };
+
+    // Batched random-access reads through io_uring (raw syscalls, no liburing).
+    //
+    // IN FLIGHT: read() keeps up to `depth` reads queued in the kernel at once and refills the
+    // submission ring as completions come back, so a gather of thousands of small records
+    // costs a handful of syscalls instead of one pread each, and an NVMe drive sees a deep
+    // queue instead of one request at a time.
+    //
+    // REGISTERED BUFFERS: the kernel reads into `depth` fixed staging slots registered once
+    // (IORING_OP_READ_FIXED), so it doesn't have to pin and map user pages on every read.
+    // The bytes are then copied to each request's destination.
+    //
+    // O_DIRECT (optional) bypasses the page cache for datasets much bigger than RAM; reads are
+    // widened to 4 KiB boundaries and the requested bytes cut out of the staging slot.
+    //
+    // Kernels without io_uring (or where it is disabled) fall back to pread, same results.
+    class AsyncReader {
+    public:
+        static constexpr size_t alignment = 4096; // O_DIRECT offset/length/buffer alignment
+
+        explicit AsyncReader(unsigned queueDepth = 64, size_t slotBytes = 64 * 1024)
+        : depth(queueDepth < 1 ? 1 : queueDepth),
+          slotSize((slotBytes + alignment - 1) / alignment * alignment) {}
+
+        ~AsyncReader() {
+            close();
+            teardownRing();
+        }
+
+        AsyncReader(const AsyncReader&) = delete;
+        AsyncReader& operator=(const AsyncReader&) = delete;
+
+        // Closes every file, then opens `path` as file 0
+        bool open(const std::string& path, bool direct = false) {
+            close();
+            return addFile(path, direct) >= 0;
+        }
+
+        // One ring serves any number of files (e.g. dataset shards): returns the index to put
+        // in ReadRequest::file, or -1
+        int addFile(const std::string& path, bool direct = false) {
+            File f;
+            f.plainFd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (f.plainFd < 0) {
+                std::cerr << "Error: Could not open " << path << ": " << std::strerror(errno) << std::endl;
+                return -1;
+            }
+            struct stat st{};
+            ::fstat(f.plainFd, &st);
+            f.length = st.st_size;
+
+            if (ringFd < 0 && !ringFailed) setupRing();
+            f.fd = f.plainFd;
+            if (direct && usingUring()) {
+                int d = ::open(path.c_str(), O_RDONLY | O_CLOEXEC | O_DIRECT);
+                if (d >= 0) {
+                    f.fd = d;
+                    f.directIo = true;
+                } else {
+                    std::cerr << "Warning: O_DIRECT not supported for " << path << ", using the page cache." << std::endl;
+                }
+            }
+            files.push_back(f);
+            return static_cast<int>(files.size()) - 1;
+        }
+
+        void close() {
+            for (auto& f : files) {
+                if (f.fd != f.plainFd) ::close(f.fd);
+                ::close(f.plainFd);
+            }
+            files.clear();
+        }
+
+        bool isOpen() const { return !files.empty(); }
+        size_t fileCount() const { return files.size(); }
+        bool usingUring() const { return ringFd >= 0 && !ringFailed; }
+        bool usingDirectIo(uint32_t file = 0) const { return file < files.size() && files[file].directIo; }
+        uint64_t size(uint32_t file = 0) const { return file < files.size() ? files[file].length : 0; }
+
+        // Reads every request and returns once all of them are done (false on an I/O error
+        // or a read past the end of the file)
+        bool read(const std::vector<ReadRequest>& requests) {
+            if (!isOpen()) return false;
+            for (auto& r : requests) {
+                if (r.file >= files.size() || r.offset + r.length > files[r.file].length) {
+                    std::cerr << "Error: read past the end of the file." << std::endl;
+                    return false;
+                }
+            }
+            if (!usingUring()) return readFallback(requests);
+
+            // 1. Cut requests into slot-sized pieces (aligned spans under O_DIRECT)
+            pieces.clear();
+            for (auto& r : requests) {
+                uint64_t pos = r.offset;
+                const uint64_t end = r.offset + r.length;
+                char* dest = static_cast<char*>(r.dest);
+                const bool directIo = files[r.file].directIo;
+                while (pos < end) {
+                    Piece p;
+                    p.file = r.file;
+                    p.fileOffset = directIo ? pos / alignment * alignment : pos;
+                    p.skip = static_cast<uint32_t>(pos - p.fileOffset);
+                    p.copy = static_cast<uint32_t>(std::min<uint64_t>(end - pos, slotSize - p.skip));
+                    p.readLength = directIo
+                        ? static_cast<uint32_t>((p.skip + p.copy + alignment - 1) / alignment * alignment)
+                        : p.copy;
+                    p.dest = dest;
+                    pieces.push_back(p);
+                    pos += p.copy;
+                    dest += p.copy;
+                }
+            }
+
+            // 2. Keep the ring full: queue into free slots, submit, reap completions, repeat
+            size_t next = 0;
+            unsigned inFlight = 0, unsubmitted = 0;
+            bool ok = true;
+            while (next < pieces.size() || inFlight > 0) {
+                while (next < pieces.size() && !freeSlots.empty()) {
+                    unsigned slot = freeSlots.back();
+                    freeSlots.pop_back();
+                    queueRead(pieces[next], slot, next);
+                    next++;
+                    unsubmitted++;
+                    inFlight++;
+                }
+                int submitted = enter(unsubmitted, 1, IORING_ENTER_GETEVENTS);
+                if (submitted >= 0) {
+                    unsubmitted -= submitted;
+                } else if (errno != EAGAIN && errno != EBUSY) {
+                    // Reads may still land in the staging slots, so the ring is kept (and
+                    // freed in the destructor) but never used again
+                    std::cerr << "Error: io_uring_enter failed: " << std::strerror(errno) << std::endl;
+                    ringFailed = true;
+                    return readFallback(requests);
+                }
+                inFlight -= reap(ok);
+            }
+            return ok;
+        }
+
+    private:
+        struct File {
+            int fd = -1;       // the one the ring reads from (maybe O_DIRECT)
+            int plainFd = -1;  // buffered, for the pread fallback
+            bool directIo = false;
+            uint64_t length = 0;
+        };
+        struct Piece {
+            uint32_t file;
+            uint64_t fileOffset;
+            uint32_t readLength;
+            uint32_t skip;  // bytes at the front of the slot that weren't asked for
+            uint32_t copy;  // bytes that go to dest
+            char* dest;
+        };
+
+        unsigned depth;
+        size_t slotSize;
+        std::vector<File> files;
+        std::vector<Piece> pieces;
+
+        // Ring state
+        int ringFd = -1;
+        bool ringFailed = false;
+        void* sqMap = nullptr;
+        void* cqMap = nullptr;
+        size_t sqMapSize = 0, cqMapSize = 0;
+        io_uring_sqe* sqes = nullptr;
+        size_t sqesSize = 0;
+        unsigned *sqTail = nullptr, *sqMask = nullptr, *sqArray = nullptr;
+        unsigned *cqHead = nullptr, *cqTail = nullptr, *cqMask = nullptr;
+        io_uring_cqe* cqes = nullptr;
+        char* staging = nullptr; // depth * slotSize, registered with the kernel
+        std::vector<unsigned> freeSlots;
+
+        void setupRing() {
+            io_uring_params params{};
+            ringFd = static_cast<int>(::syscall(__NR_io_uring_setup, depth, &params));
+            if (ringFd < 0) {
+                ringFailed = true; // ENOSYS / EPERM: no io_uring here, pread it is
+                return;
+            }
+
+            // 1. Map the submission and completion rings and the SQE array
+            sqMapSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+            cqMapSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+            if (params.features & IORING_FEAT_SINGLE_MMAP) sqMapSize = cqMapSize = std::max(sqMapSize, cqMapSize);
+            sqMap = ::mmap(nullptr, sqMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQ_RING);
+            cqMap = (params.features & IORING_FEAT_SINGLE_MMAP) ? sqMap
+                : ::mmap(nullptr, cqMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_CQ_RING);
+            sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+            void* s = ::mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQES);
+            if (sqMap == MAP_FAILED || cqMap == MAP_FAILED || s == MAP_FAILED) {
+                if (s != MAP_FAILED) ::munmap(s, sqesSize);
+                if (sqMap == MAP_FAILED) sqMap = nullptr;
+                if (cqMap == MAP_FAILED) cqMap = nullptr;
+                teardownRing();
+                ringFailed = true;
+                return;
+            }
+            sqes = static_cast<io_uring_sqe*>(s);
+
+            char* sq = static_cast<char*>(sqMap);
+            sqTail  = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+            sqMask  = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+            sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+            char* cq = static_cast<char*>(cqMap);
+            cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+            cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+            cqMask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+            cqes   = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+            // 2. Register the staging slots once
+            depth = std::min(depth, params.sq_entries);
+            staging = static_cast<char*>(std::aligned_alloc(alignment, depth * slotSize));
+            std::vector<iovec> iov(depth);
+            for (unsigned i = 0; i < depth; i++) iov[i] = {staging + i * slotSize, slotSize};
+            if (!staging || ::syscall(__NR_io_uring_register, ringFd, IORING_REGISTER_BUFFERS, iov.data(), depth) < 0) {
+                teardownRing();
+                ringFailed = true;
+                return;
+            }
+            for (unsigned i = 0; i < depth; i++) freeSlots.push_back(depth - 1 - i);
+        }
+
+        void teardownRing() {
+            if (sqes) ::munmap(sqes, sqesSize);
+            if (cqMap && cqMap != sqMap) ::munmap(cqMap, cqMapSize);
+            if (sqMap) ::munmap(sqMap, sqMapSize);
+            if (ringFd >= 0) ::close(ringFd); // also unregisters the buffers
+            std::free(staging);
+            sqes = nullptr;
+            sqMap = cqMap = nullptr;
+            staging = nullptr;
+            ringFd = -1;
+            freeSlots.clear();
+        }
+
+        int enter(unsigned toSubmit, unsigned minComplete, unsigned flags) {
+            int r;
+            do {
+                r = static_cast<int>(::syscall(__NR_io_uring_enter, ringFd, toSubmit, minComplete, flags, nullptr, 0));
+            } while (r < 0 && errno == EINTR);
+            return r;
+        }
+
+        void queueRead(const Piece& p, unsigned slot, size_t index) {
+            // Only this thread produces: a relaxed read of our own tail, release to publish
+            const unsigned tail = std::atomic_ref<unsigned>(*sqTail).load(std::memory_order_relaxed);
+            const unsigned i = tail & *sqMask;
+            io_uring_sqe& sqe = sqes[i];
+            std::memset(&sqe, 0, sizeof(sqe));
+            sqe.opcode = IORING_OP_READ_FIXED;
+            sqe.fd = files[p.file].fd;
+            sqe.off = p.fileOffset;
+            sqe.addr = reinterpret_cast<uint64_t>(staging + static_cast<size_t>(slot) * slotSize);
+            sqe.len = p.readLength;
+            sqe.buf_index = static_cast<uint16_t>(slot);
+            sqe.user_data = (static_cast<uint64_t>(index) << 16) | slot;
+            sqArray[i] = i;
+            std::atomic_ref<unsigned>(*sqTail).store(tail + 1, std::memory_order_release);
+        }
+
+        // Copies finished pieces out of their slots; returns how many completed
+        unsigned reap(bool& ok) {
+            unsigned done = 0;
+            unsigned head = std::atomic_ref<unsigned>(*cqHead).load(std::memory_order_relaxed);
+            const unsigned tail = std::atomic_ref<unsigned>(*cqTail).load(std::memory_order_acquire);
+            for (; head != tail; head++, done++) {
+                const io_uring_cqe& cqe = cqes[head & *cqMask];
+                const unsigned slot = static_cast<unsigned>(cqe.user_data & 0xFFFF);
+                const Piece& p = pieces[cqe.user_data >> 16];
+                const char* src = staging + static_cast<size_t>(slot) * slotSize + p.skip;
+
+                if (cqe.res >= static_cast<int>(p.skip + p.copy)) {
+                    std::memcpy(p.dest, src, p.copy);
+                } else if (cqe.res >= 0) {
+                    // Short read: finish the piece synchronously
+                    ok = preadAll(p.file, p.dest, p.copy, p.fileOffset + p.skip) && ok;
+                } else {
+                    std::cerr << "Error: async read failed: " << std::strerror(-cqe.res) << std::endl;
+                    ok = false;
+                }
+                freeSlots.push_back(slot);
+            }
+            std::atomic_ref<unsigned>(*cqHead).store(head, std::memory_order_release);
+            return done;
+        }
+
+        bool preadAll(uint32_t file, void* dest, size_t bytes, uint64_t offset) {
+            char* out = static_cast<char*>(dest);
+            while (bytes > 0) {
+                ssize_t n = ::pread(files[file].plainFd, out, bytes, offset);
+                if (n < 0 && errno == EINTR) continue;
+                if (n <= 0) return false;
+                out += n;
+                bytes -= n;
+                offset += n;
+            }
+            return true;
+        }
+
+        bool readFallback(const std::vector<ReadRequest>& requests) {
+            for (auto& r : requests) {
+                if (!preadAll(r.file, r.dest, r.length, r.offset)) {
+                    std::cerr << "Error: read failed: " << std::strerror(errno) << std::endl;
+                    return false;
+                }
+            }
+            return true;
+        }
+    };
+}
@@ -0,0 +1,337 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <iostream>
+#include <random>
+
+#include "activation.h"
+#include "kernels.h"
+
+namespace NN {
+
+    // Bump allocator for one training step. alloc() just moves an offset forward;
+    // reset() throws everything away at once. If a step needed more than one block,
+    // the next reset() merges them into a single block of the combined size, so after
+    // the first step no allocation happens at all.
+    class Arena {
+    public:
+        explicit Arena(size_t initialFloats = 1 << 16) {
+            blocks.emplace_back(new float[initialFloats]);
+            blockSizes.push_back(initialFloats);
+        }
+
+        float* alloc(size_t n) {
+            if (offset + n > blockSizes.back()) {
+                size_t size = std::max(n, blockSizes.back() * 2);
+                blocks.emplace_back(new float[size]);
+                blockSizes.push_back(size);
+                offset = 0;
+            }
+            float* p = blocks.back().get() + offset;
+            offset += n;
+            return p;
+        }
+
+        float* allocZeroed(size_t n) {
+            float* p = alloc(n);
+            std::memset(p, 0, n * sizeof(float));
+            return p;
+        }
+
+        void reset() {
+            if (blocks.size() > 1) {
+                size_t total = 0;
+                for (size_t s : blockSizes) total += s;
+                blocks.clear();
+                blockSizes.clear();
+                blocks.emplace_back(new float[total]);
+                blockSizes.push_back(total);
+            }
+            offset = 0;
+        }
+
+    private:
+        std::vector<std::unique_ptr<float[]>> blocks;
+        std::vector<size_t> blockSizes;
+        size_t offset = 0;
+    };
+
+    // A trainable tensor that lives across steps (weights, biases, ...)
+    struct Parameter {
+        int rows;
+        int cols;
+        std::vector<float> value;
+        std::vector<float> grad;
+
+        Parameter(int r, int c, float initRange = 0.0f) : rows(r), cols(c), value(r * c, 0.0f), grad(r * c, 0.0f) {
+            if (initRange > 0.0f) {
+                std::mt19937 gen(std::random_device{}());
+                std::uniform_real_distribution<float> dis(-initRange, initRange);
+                for (auto& v : value) v = dis(gen);
+            }
+        }
+
+        int size() const { return rows * cols; }
+
+        // Plain SGD, then clear the gradient for the next step
+        void step(float learningRate) {
+            for (size_t i = 0; i < value.size(); i++) {
+                value[i] -= learningRate * grad[i];
+                grad[i] = 0.0f;
+            }
+        }
+    };
+
+    // Handle to a value recorded on the Tape
+    struct Var {
+        int id = -1;
+    };
+
+    // Reverse-mode autodiff. Every op computes its forward value immediately and records
+    // itself; backward() walks the records in reverse. All intermediate values and gradients
+    // come from the Arena, so a whole step costs no heap allocation once it has warmed up.
+    //
+    // Usage per step:
+    //     tape.reset();
+    //     Var x = tape.input(img.pixels);
+    //     Var h = tape.dense(x, W1, b1, ActivationType::Tanh);
+    //     Var y = tape.dense(h, W2, b2, ActivationType::Sigmoid);
+    //     tape.backward(tape.mse(y, img.target));
+    //     W1.step(lr); b1.step(lr); ...
+    class Tape {
+    public:
+        enum class Op { Input, Param, Add, Mul, Activation, MatVec, Dense, Sum, MSE, SoftmaxCrossEntropy };
+
+        struct Node {
+            Op op;
+            int size;
+            float* value;
+            float* grad;
+            int a = -1;
+            int b = -1;
+            Parameter* p0 = nullptr; // weights (MatVec, Dense)
+            Parameter* p1 = nullptr; // biases (Dense)
+            ActivationType act = ActivationType::Tanh;
+            const float* aux = nullptr; // targets (losses)
+            float* saved = nullptr;     // forward results the backward needs (softmax probs)
+        };
+
+        Arena arena;
+        std::vector<Node> nodes;
+
+        void reset() {
+            nodes.clear();
+            arena.reset();
+        }
+
+        const float* value(Var v) const { return nodes[v.id].value; }
+        int size(Var v) const { return nodes[v.id].size; }
+
+        // --- LEAVES ---
+
+        Var input(const std::vector<float>& data) {
+            Node n = makeNode(Op::Input, static_cast<int>(data.size()));
+            std::memcpy(n.value, data.data(), data.size() * sizeof(float));
+            return push(n);
+        }
+
+        // Parameters are read and written in place, no copy
+        Var param(Parameter& p) {
+            Node n;
+            n.op = Op::Param;
+            n.size = p.size();
+            n.value = p.value.data();
+            n.grad = p.grad.data();
+            return push(n);
+        }
+
+        // --- ELEMENTWISE ---
+
+        Var add(Var a, Var b) {
+            Node n = makeNode(Op::Add, size(a), a, b);
+            const float* x = value(a);
+            const float* y = value(b);
+            for (int i = 0; i < n.size; i++) n.value[i] = x[i] + y[i];
+            return push(n);
+        }
+
+        Var mul(Var a, Var b) {
+            Node n = makeNode(Op::Mul, size(a), a, b);
+            const float* x = value(a);
+            const float* y = value(b);
+            for (int i = 0; i < n.size; i++) n.value[i] = x[i] * y[i];
+            return push(n);
+        }
+
+        Var activation(Var a, ActivationType act) {
+            Node n = makeNode(Op::Activation, size(a), a);
+            n.act = act;
+            const float* x = value(a);
+            for (int i = 0; i < n.size; i++) n.value[i] = activate(act, x[i]);
+            return push(n);
+        }
+
+        Var sum(Var a) {
+            Node n = makeNode(Op::Sum, 1, a);
+            const float* x = value(a);
+            n.value[0] = 0.0f;
+            for (int i = 0; i < size(a); i++) n.value[0] += x[i];
+            return push(n);
+        }
+
+        // --- LINEAR ALGEBRA ---
+
+        // y = x * W, W is [size(x)][cols] like Layer::weights
+        Var matvec(Var x, Parameter& W) {
+            Node n = makeNode(Op::MatVec, W.cols, x);
+            n.p0 = &W;
+            Kernels::linearForward(value(x), W.value.data(), nullptr, n.value, W.rows, W.cols);
+            return push(n);
+        }
+
+        // FUSED: y = f(x * W + b). One record instead of matvec + add + activation,
+        // and its backward computes delta once and reuses the Layer kernels.
+        Var dense(Var x, Parameter& W, Parameter& b, ActivationType act) {
+            Node n = makeNode(Op::Dense, W.cols, x);
+            n.p0 = &W;
+            n.p1 = &b;
+            n.act = act;
+            Kernels::parallelDenseForward(value(x), W.value.data(), b.value.data(), n.value, W.rows, W.cols, act);
+            return push(n);
+        }
+
+        // --- LOSSES (scalar) ---
+
+        // 0.5 * sum((pred - target)^2), so the gradient is (pred - target) like NeuralNetwork::train
+        Var mse(Var pred, const std::vector<float>& target) {
+            Node n = makeNode(Op::MSE, 1, pred);
+            n.aux = target.data();
+            const float* y = value(pred);
+            n.value[0] = 0.0f;
+            for (int i = 0; i < size(pred); i++) {
+                float d = y[i] - target[i];
+                n.value[0] += 0.5f * d * d;
+            }
+            return push(n);
+        }
+
+        // FUSED: softmax + cross entropy on raw logits. Gradient is simply (softmax - target).
+        Var softmaxCrossEntropy(Var logits, const std::vector<float>& target) {
+            Node n = makeNode(Op::SoftmaxCrossEntropy, 1, logits);
+            n.aux = target.data();
+            const int k = size(logits);
+            const float* z = value(logits);
+
+            // Keep the probabilities for the backward pass
+            float* probs = arena.alloc(k);
+            float maxZ = *std::max_element(z, z + k);
+            float total = 0.0f;
+            for (int i = 0; i < k; i++) {
+                probs[i] = std::exp(z[i] - maxZ);
+                total += probs[i];
+            }
+            n.value[0] = 0.0f;
+            for (int i = 0; i < k; i++) {
+                probs[i] /= total;
+                if (target[i] > 0.0f) n.value[0] -= target[i] * std::log(std::max(probs[i], 1e-12f));
+            }
+            n.saved = probs;
+            return push(n);
+        }
+
+        // --- BACKWARD ---
+
+        void backward(Var loss) {
+            nodes[loss.id].grad[0] = 1.0f;
+
+            for (int id = loss.id; id >= 0; id--) {
+                Node& n = nodes[id];
+                const float* g = n.grad;
+
+                switch (n.op) {
+                    case Op::Input:
+                    case Op::Param:
+                        break;
+
+                    case Op::Add: {
+                        float* ga = nodes[n.a].grad;
+                        float* gb = nodes[n.b].grad;
+                        for (int i = 0; i < n.size; i++) {
+                            ga[i] += g[i];
+                            gb[i] += g[i];
+                        }
+                        break;
+                    }
+                    case Op::Mul: {
+                        float* ga = nodes[n.a].grad;
+                        float* gb = nodes[n.b].grad;
+                        const float* va = nodes[n.a].value;
+                        const float* vb = nodes[n.b].value;
+                        for (int i = 0; i < n.size; i++) {
+                            ga[i] += g[i] * vb[i];
+                            gb[i] += g[i] * va[i];
+                        }
+                        break;
+                    }
+                    case Op::Activation: {
+                        float* ga = nodes[n.a].grad;
+                        for (int i = 0; i < n.size; i++) ga[i] += g[i] * activateDerivative(n.act, n.value[i]);
+                        break;
+                    }
+                    case Op::Sum: {
+                        float* ga = nodes[n.a].grad;
+                        for (int i = 0; i < nodes[n.a].size; i++) ga[i] += g[0];
+                        break;
+                    }
+                    case Op::MatVec: {
+                        Parameter& W = *n.p0;
+                        Kernels::parallelDenseParamGradients(nodes[n.a].value, g, W.grad.data(), nullptr, W.rows, W.cols);
+                        Kernels::parallelDenseInputGradients(g, W.value.data(), nodes[n.a].grad, W.rows, W.cols);
+                        break;
+                    }
+                    case Op::Dense: {
+                        Parameter& W = *n.p0;
+                        Parameter& b = *n.p1;
+                        float* delta = arena.alloc(n.size);
+                        Kernels::parallelActivationDelta(g, n.value, delta, n.size, n.act);
+                        Kernels::parallelDenseParamGradients(nodes[n.a].value, delta, W.grad.data(), b.grad.data(), W.rows, W.cols);
+                        Kernels::parallelDenseInputGradients(delta, W.value.data(), nodes[n.a].grad, W.rows, W.cols);
+                        break;
+                    }
+                    case Op::MSE: {
+                        float* ga = nodes[n.a].grad;
+                        const float* y = nodes[n.a].value;
+                        for (int i = 0; i < nodes[n.a].size; i++) ga[i] += g[0] * (y[i] - n.aux[i]);
+                        break;
+                    }
+                    case Op::SoftmaxCrossEntropy: {
+                        float* ga = nodes[n.a].grad;
+                        for (int i = 0; i < nodes[n.a].size; i++) ga[i] += g[0] * (n.saved[i] - n.aux[i]);
+                        break;
+                    }
+                }
+            }
+        }
+
+    private:
+        Node makeNode(Op op, int size, Var a = {}, Var b = {}) {
+            Node n;
+            n.op = op;
+            n.size = size;
+            n.value = arena.alloc(size);
+            n.grad = arena.allocZeroed(size);
+            n.a = a.id;
+            n.b = b.id;
+            return n;
+        }
+
+        Var push(const Node& n) {
+            nodes.push_back(n);
+            return Var{static_cast<int>(nodes.size()) - 1};
+        }
+    };
+}
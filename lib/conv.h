@@ -0,0 +1,353 @@
+#pragma once
+
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <iostream>
+#include <random>
+#include <fstream>
+#include <stdexcept>
+#include <cstdint>
+
+#include "activation.h"
+
+namespace NN {
+
+    // 2D Convolution ("valid" padding, stride 1). Same interface as the dense Layer:
+    // flat std::vector<float> in, flat std::vector<float> out, laid out as [channel][y][x].
+    //
+    // INFERENCE: 3x3 layers can switch to Winograd F(2x2,3x3). The filters are transformed
+    // once (prepareWinograd), which drops the multiplications per output from 9 to 4 per
+    // input channel (2.25x fewer). Training always uses the direct path, because the
+    // weights change every step and the pretransformed filters would go stale.
+    class ConvLayer {
+    public:
+        static constexpr char tag = 'c';
+
+        int inChannels;
+        int outChannels;
+        int inWidth;
+        int inHeight;
+        int kernelSize;
+        int outWidth;
+        int outHeight;
+        ActivationType actType;
+
+        std::vector<float> weights; // [out][in][ky][kx]
+        std::vector<float> biases;  // [out]
+
+        // MEMORY: Same as Layer, needed for the gradients
+        std::vector<float> lastInputs;
+        std::vector<float> lastOutputs;
+
+        // WINOGRAD: U = G g G^T for every (out, in) pair, 16 floats each
+        std::vector<float> winogradFilters;
+        bool winogradReady = false;
+        // Max relative error allowed vs the direct path before we refuse to use Winograd
+        float winogradTolerance = 1e-4f;
+
+        ConvLayer(int inC, int outC, int inW, int inH, int k, ActivationType act)
+        : inChannels(inC), outChannels(outC), inWidth(inW), inHeight(inH), kernelSize(k),
+          outWidth(inW - k + 1), outHeight(inH - k + 1), actType(act) {
+            // Same rule as PoolLayer: a geometry the loops cannot run is an error, not a clamp
+            const int64_t weightCount = int64_t(outC) * inC * k * k;
+            if (inC <= 0 || outC <= 0 || k <= 0 || k > inW || k > inH ||
+                weightCount > INT32_MAX || int64_t(inC) * inW * inH > INT32_MAX) {
+                throw std::invalid_argument("ConvLayer: sizes must be positive, the kernel must fit the input");
+            }
+            weights.resize(outChannels * inChannels * kernelSize * kernelSize);
+            biases.resize(outChannels);
+
+            std::random_device rd;
+            std::mt19937 gen(rd());
+            // Scale by fan-in, otherwise the sums over inC*k*k inputs saturate tanh/sigmoid
+            float range = 1.0f / std::sqrt(static_cast<float>(inChannels * kernelSize * kernelSize));
+            std::uniform_real_distribution<float> dis(-range, range);
+            for (auto& w : weights) w = dis(gen);
+            for (auto& b : biases) b = dis(gen);
+        }
+
+        int inputSize() const { return inChannels * inWidth * inHeight; }
+        int outputSize() const { return outChannels * outWidth * outHeight; }
+
+        // 1. FORWARD PASS
+        std::vector<float> calculateOutput(const std::vector<float>& inputs) {
+            this->lastInputs = inputs;
+            std::vector<float> outputs(outputSize(), 0.0f);
+
+            if (winogradReady) {
+                convolveWinograd(inputs, outputs);
+            } else {
+                convolveDirect(inputs, outputs);
+            }
+            for (auto& v : outputs) v = activate(actType, v);
+
+            this->lastOutputs = outputs;
+            return outputs;
+        }
+
+        // Inference only: no memory kept, so many threads may call it at once
+        std::vector<float> infer(const std::vector<float>& inputs) const {
+            std::vector<float> outputs(outputSize(), 0.0f);
+            if (winogradReady) {
+                convolveWinograd(inputs, outputs);
+            } else {
+                convolveDirect(inputs, outputs);
+            }
+            for (auto& v : outputs) v = activate(actType, v);
+            return outputs;
+        }
+
+        // 2. BACKWARD PASS (Gradient Descent)
+        // Returns: Gradients for the PREVIOUS layer
+        std::vector<float> backPropagate(const std::vector<float>& outputGradients, float learningRate, float l1 = 0.0f) {
+            std::vector<float> inputGradients(inputSize(), 0.0f);
+            const int kk = kernelSize * kernelSize;
+            const int outPlane = outWidth * outHeight;
+            const int inPlane = inWidth * inHeight;
+
+            // delta = error_term * derivative_of_activation
+            std::vector<float> delta(outputSize());
+            for (size_t i = 0; i < delta.size(); i++) {
+                delta[i] = outputGradients[i] * activateDerivative(actType, lastOutputs[i]);
+            }
+
+            for (int o = 0; o < outChannels; o++) {
+                const float* d = &delta[o * outPlane];
+
+                float biasGrad = 0.0f;
+                for (int i = 0; i < outPlane; i++) biasGrad += d[i];
+
+                for (int c = 0; c < inChannels; c++) {
+                    const float* in = &lastInputs[c * inPlane];
+                    float* inGrad = &inputGradients[c * inPlane];
+                    float* w = &weights[(o * inChannels + c) * kk];
+
+                    for (int ky = 0; ky < kernelSize; ky++) {
+                        for (int kx = 0; kx < kernelSize; kx++) {
+                            float wv = w[ky * kernelSize + kx];
+                            float wGrad = 0.0f;
+                            for (int y = 0; y < outHeight; y++) {
+                                const float* inRow = &in[(y + ky) * inWidth + kx];
+                                float* inGradRow = &inGrad[(y + ky) * inWidth + kx];
+                                const float* dRow = &d[y * outWidth];
+                                for (int x = 0; x < outWidth; x++) {
+                                    wGrad += dRow[x] * inRow[x];
+                                    inGradRow[x] += dRow[x] * wv;
+                                }
+                            }
+                            float l1term = (wv > 0.0f) ? 1.0f : (wv < 0.0f ? -1.0f : 0.0f);
+                            w[ky * kernelSize + kx] -= learningRate * (wGrad + l1 * l1term);
+                        }
+                    }
+                }
+                biases[o] -= learningRate * biasGrad;
+            }
+
+            // The weights moved, so any pretransformed filters are stale now
+            winogradReady = false;
+            return inputGradients;
+        }
+
+        // Pretransform the filters for the Winograd path. Call once after training/loading.
+        // Returns false (and keeps the direct path) if the layer is not 3x3, or if the
+        // transformed result drifts further than `winogradTolerance` from the direct one.
+        bool prepareWinograd() {
+            winogradReady = false;
+            if (kernelSize != 3) return false;
+
+            winogradFilters.resize(outChannels * inChannels * 16);
+            for (int i = 0; i < outChannels * inChannels; i++) {
+                transformFilter(&weights[i * 9], &winogradFilters[i * 16]);
+            }
+
+            // NUMERICAL CHECK: compare both paths on a fixed probe input
+            std::mt19937 gen(1234);
+            std::uniform_real_distribution<float> dis(0.0f, 1.0f);
+            std::vector<float> probe(inputSize());
+            for (auto& p : probe) p = dis(gen);
+
+            std::vector<float> direct(outputSize(), 0.0f);
+            std::vector<float> fast(outputSize(), 0.0f);
+            convolveDirect(probe, direct);
+            convolveWinograd(probe, fast);
+
+            float maxErr = 0.0f;
+            float maxVal = 0.0f;
+            for (size_t i = 0; i < direct.size(); i++) {
+                maxErr = std::max(maxErr, std::fabs(direct[i] - fast[i]));
+                maxVal = std::max(maxVal, std::fabs(direct[i]));
+            }
+            float relErr = maxErr / (maxVal + 1e-12f);
+            if (relErr > winogradTolerance) {
+                std::cerr << "Warning: Winograd error " << relErr << " above tolerance, using direct convolution." << std::endl;
+                return false;
+            }
+
+            winogradReady = true;
+            return true;
+        }
+
+        void write(std::ostream& file) const {
+            file.write((char*)&inChannels, sizeof(int));
+            file.write((char*)&outChannels, sizeof(int));
+            file.write((char*)&inWidth, sizeof(int));
+            file.write((char*)&inHeight, sizeof(int));
+            file.write((char*)&kernelSize, sizeof(int));
+            file.write((char*)&actType, sizeof(ActivationType));
+            file.write((char*)weights.data(), weights.size() * sizeof(float));
+            file.write((char*)biases.data(), biases.size() * sizeof(float));
+        }
+
+        // Loaded layers are only used for inference, so the filters are pretransformed here
+        static ConvLayer read(std::istream& file) {
+            int inC, outC, inW, inH, k;
+            ActivationType act;
+            file.read((char*)&inC, sizeof(int));
+            file.read((char*)&outC, sizeof(int));
+            file.read((char*)&inW, sizeof(int));
+            file.read((char*)&inH, sizeof(int));
+            file.read((char*)&k, sizeof(int));
+            file.read((char*)&act, sizeof(ActivationType));
+
+            ConvLayer l(inC, outC, inW, inH, k, act);
+            file.read((char*)l.weights.data(), l.weights.size() * sizeof(float));
+            file.read((char*)l.biases.data(), l.biases.size() * sizeof(float));
+            l.prepareWinograd();
+            return l;
+        }
+
+    private:
+        // Pre-activation sums, plain sliding window
+        void convolveDirect(const std::vector<float>& inputs, std::vector<float>& outputs) const {
+            const int kk = kernelSize * kernelSize;
+            const int outPlane = outWidth * outHeight;
+            const int inPlane = inWidth * inHeight;
+
+            for (int o = 0; o < outChannels; o++) {
+                float* out = &outputs[o * outPlane];
+                std::fill(out, out + outPlane, biases[o]);
+
+                for (int c = 0; c < inChannels; c++) {
+                    const float* in = &inputs[c * inPlane];
+                    const float* w = &weights[(o * inChannels + c) * kk];
+                    for (int ky = 0; ky < kernelSize; ky++) {
+                        for (int kx = 0; kx < kernelSize; kx++) {
+                            float wv = w[ky * kernelSize + kx];
+                            for (int y = 0; y < outHeight; y++) {
+                                const float* inRow = &in[(y + ky) * inWidth + kx];
+                                float* outRow = &out[y * outWidth];
+                                for (int x = 0; x < outWidth; x++) {
+                                    outRow[x] += wv * inRow[x];
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+        }
+
+        // Pre-activation sums via F(2x2,3x3): Y = A^T [ sum_c (U_c .* V_c) ] A, V = B^T d B
+        void convolveWinograd(const std::vector<float>& inputs, std::vector<float>& outputs) const {
+            const int outPlane = outWidth * outHeight;
+            const int inPlane = inWidth * inHeight;
+            const int tilesX = (outWidth + 1) / 2;
+            const int tilesY = (outHeight + 1) / 2;
+
+            std::vector<float> V(inChannels * 16);
+            float d[16];
+            float M[16];
+            float Y[4];
+
+            for (int ty = 0; ty < tilesY; ty++) {
+                for (int tx = 0; tx < tilesX; tx++) {
+                    const int y0 = ty * 2;
+                    const int x0 = tx * 2;
+
+                    // 1. Transform the 4x4 input tile of every channel (zero-padded at the edges)
+                    for (int c = 0; c < inChannels; c++) {
+                        const float* in = &inputs[c * inPlane];
+                        for (int i = 0; i < 4; i++) {
+                            for (int j = 0; j < 4; j++) {
+                                int y = y0 + i;
+                                int x = x0 + j;
+                                d[i * 4 + j] = (y < inHeight && x < inWidth) ? in[y * inWidth + x] : 0.0f;
+                            }
+                        }
+                        transformInput(d, &V[c * 16]);
+                    }
+
+                    // 2. Elementwise products accumulated over channels, then back to 2x2
+                    for (int o = 0; o < outChannels; o++) {
+                        std::fill(M, M + 16, 0.0f);
+                        const float* U = &winogradFilters[o * inChannels * 16];
+                        for (int c = 0; c < inChannels; c++) {
+                            const float* u = &U[c * 16];
+                            const float* v = &V[c * 16];
+                            for (int e = 0; e < 16; e++) M[e] += u[e] * v[e];
+                        }
+                        transformOutput(M, Y);
+
+                        float* out = &outputs[o * outPlane];
+                        for (int i = 0; i < 2; i++) {
+                            for (int j = 0; j < 2; j++) {
+                                int y = y0 + i;
+                                int x = x0 + j;
+                                if (y < outHeight && x < outWidth) {
+                                    out[y * outWidth + x] = Y[i * 2 + j] + biases[o];
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+        }
+
+        // U = G g G^T, G = [1 0 0; .5 .5 .5; .5 -.5 .5; 0 0 1]
+        static void transformFilter(const float* g, float* U) {
+            float t[12]; // 4x3
+            for (int j = 0; j < 3; j++) {
+                t[0 * 3 + j] = g[0 * 3 + j];
+                t[1 * 3 + j] = 0.5f * (g[0 * 3 + j] + g[1 * 3 + j] + g[2 * 3 + j]);
+                t[2 * 3 + j] = 0.5f * (g[0 * 3 + j] - g[1 * 3 + j] + g[2 * 3 + j]);
+                t[3 * 3 + j] = g[2 * 3 + j];
+            }
+            for (int i = 0; i < 4; i++) {
+                U[i * 4 + 0] = t[i * 3 + 0];
+                U[i * 4 + 1] = 0.5f * (t[i * 3 + 0] + t[i * 3 + 1] + t[i * 3 + 2]);
+                U[i * 4 + 2] = 0.5f * (t[i * 3 + 0] - t[i * 3 + 1] + t[i * 3 + 2]);
+                U[i * 4 + 3] = t[i * 3 + 2];
+            }
+        }
+
+        // V = B^T d B, B^T = [1 0 -1 0; 0 1 1 0; 0 -1 1 0; 0 1 0 -1]
+        static void transformInput(const float* d, float* V) {
+            float t[16];
+            for (int j = 0; j < 4; j++) {
+                t[0 * 4 + j] = d[0 * 4 + j] - d[2 * 4 + j];
+                t[1 * 4 + j] = d[1 * 4 + j] + d[2 * 4 + j];
+                t[2 * 4 + j] = d[2 * 4 + j] - d[1 * 4 + j];
+                t[3 * 4 + j] = d[1 * 4 + j] - d[3 * 4 + j];
+            }
+            for (int i = 0; i < 4; i++) {
+                V[i * 4 + 0] = t[i * 4 + 0] - t[i * 4 + 2];
+                V[i * 4 + 1] = t[i * 4 + 1] + t[i * 4 + 2];
+                V[i * 4 + 2] = t[i * 4 + 2] - t[i * 4 + 1];
+                V[i * 4 + 3] = t[i * 4 + 1] - t[i * 4 + 3];
+            }
+        }
+
+        // Y = A^T M A, A^T = [1 1 1 0; 0 1 -1 -1]
+        static void transformOutput(const float* M, float* Y) {
+            float t[8]; // 2x4
+            for (int j = 0; j < 4; j++) {
+                t[0 * 4 + j] = M[0 * 4 + j] + M[1 * 4 + j] + M[2 * 4 + j];
+                t[1 * 4 + j] = M[1 * 4 + j] - M[2 * 4 + j] - M[3 * 4 + j];
+            }
+            for (int i = 0; i < 2; i++) {
+                Y[i * 2 + 0] = t[i * 4 + 0] + t[i * 4 + 1] + t[i * 4 + 2];
+                Y[i * 2 + 1] = t[i * 4 + 1] - t[i * 4 + 2] - t[i * 4 + 3];
+            }
+        }
+    };
+}
@@ -0,0 +1,290 @@
+#pragma once
+
+#include <coroutine>
+#include <deque>
+#include <optional>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <utility>
+
+#include "thread_pool.h"
+
+namespace NN {
+
+    // Runs coroutines on the shared ThreadPool. A suspended coroutine that becomes ready is
+    // POSTED: its handle goes on a ready queue and a pool task resumes it, so stages never own
+    // a thread and never block one while they wait. The thread in run() resumes handles too,
+    // which also keeps everything working when the pool has no workers (NN_NUM_THREADS=1).
+    //
+    // LIFETIME: a pool task may find its handle already taken by run() and still be queued
+    // when the last coroutine finishes. `pending` counts those tasks; run() and the destructor
+    // wait for it to reach zero, so no task ever touches a destroyed scheduler.
+    class CoroScheduler {
+    public:
+        explicit CoroScheduler(ThreadPool& p = ThreadPool::instance()) : pool(p) {}
+
+        ~CoroScheduler() {
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait(lock, [&] { return pending == 0; });
+        }
+
+        CoroScheduler(const CoroScheduler&) = delete;
+        CoroScheduler& operator=(const CoroScheduler&) = delete;
+
+        void post(std::coroutine_handle<> h) {
+            const bool usePool = pool.size() > 1;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                ready.push_back(h);
+                if (usePool) pending++;
+                cv.notify_all();
+            }
+            if (usePool) pool.submit([this] { resumeOne(); });
+        }
+
+        // co_await scheduler.schedule(): continue on a pool thread
+        auto schedule() {
+            struct Awaiter {
+                CoroScheduler& self;
+                bool await_ready() const noexcept { return false; }
+                void await_suspend(std::coroutine_handle<> h) { self.post(h); }
+                void await_resume() const noexcept {}
+            };
+            return Awaiter{*this};
+        }
+
+        // Blocks until every spawned task has finished and no pool task is left, resuming
+        // ready coroutines meanwhile
+        void run() {
+            std::unique_lock<std::mutex> lock(mutex);
+            while (active > 0 || pending > 0) {
+                if (ready.empty()) {
+                    cv.wait(lock);
+                    continue;
+                }
+                auto h = ready.front();
+                ready.pop_front();
+                lock.unlock();
+                h.resume();
+                lock.lock();
+            }
+        }
+
+    private:
+        template <class> friend class Channel;
+        friend class Task;
+
+        ThreadPool& pool;
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::deque<std::coroutine_handle<>> ready;
+        int active = 0;  // spawned tasks that haven't finished
+        int pending = 0; // pool tasks submitted by post() that haven't returned
+
+        // One pool task per post; it may find the queue already drained by someone else
+        void resumeOne() {
+            std::coroutine_handle<> h;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!ready.empty()) {
+                    h = ready.front();
+                    ready.pop_front();
+                }
+            }
+            if (h) h.resume();
+
+            // Last use of `this`: notify under the lock, so run() cannot return before it
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--pending == 0) cv.notify_all();
+        }
+
+        void started() {
+            std::lock_guard<std::mutex> lock(mutex);
+            active++;
+        }
+
+        void finished() {
+            std::lock_guard<std::mutex> lock(mutex);
+            active--;
+            cv.notify_all();
+        }
+    };
+
+    // A stage: a coroutine that starts suspended and is handed to CoroScheduler::spawn.
+    // Its frame frees itself when the body returns.
+    class Task {
+    public:
+        struct promise_type {
+            CoroScheduler* scheduler = nullptr;
+
+            Task get_return_object() { return Task(std::coroutine_handle<promise_type>::from_promise(*this)); }
+            std::suspend_always initial_suspend() noexcept { return {}; }
+            auto final_suspend() noexcept {
+                struct Done {
+                    bool await_ready() const noexcept { return false; }
+                    void await_suspend(std::coroutine_handle<promise_type> h) noexcept {
+                        CoroScheduler* s = h.promise().scheduler;
+                        h.destroy();
+                        if (s) s->finished();
+                    }
+                    void await_resume() const noexcept {}
+                };
+                return Done{};
+            }
+            void return_void() {}
+            void unhandled_exception() { std::terminate(); }
+        };
+
+        Task(Task&& other) noexcept : handle(std::exchange(other.handle, nullptr)) {}
+        Task(const Task&) = delete;
+        Task& operator=(const Task&) = delete;
+        ~Task() {
+            if (handle) handle.destroy(); // never spawned
+        }
+
+        // Queues the task on `scheduler`; scheduler.run() waits for it
+        void spawn(CoroScheduler& scheduler) && {
+            auto h = std::exchange(handle, nullptr);
+            h.promise().scheduler = &scheduler;
+            scheduler.started();
+            scheduler.post(h);
+        }
+
+    private:
+        explicit Task(std::coroutine_handle<promise_type> h) : handle(h) {}
+        std::coroutine_handle<promise_type> handle;
+    };
+
+    // Bounded multi-producer / multi-consumer channel between stages.
+    //
+    // BACK-PRESSURE: co_await send() suspends the producer while `capacity` items are queued,
+    // and co_await receive() suspends the consumer while it is empty. A slow stage therefore
+    // throttles everything upstream of it instead of letting queues (and memory) grow.
+    //
+    // Every producer calls close() once when it is done; after the last one, receivers drain
+    // what is left and then get std::nullopt.
+    template <class T>
+    class Channel {
+    public:
+        Channel(CoroScheduler& s, size_t cap, int producerCount = 1)
+        : scheduler(s), capacity(cap < 1 ? 1 : cap), producers(producerCount) {}
+
+        Channel(const Channel&) = delete;
+        Channel& operator=(const Channel&) = delete;
+
+        // co_await channel.send(value) -> false if the channel was already closed
+        auto send(T value) {
+            struct Awaiter {
+                Channel& ch;
+                T value;
+                bool accepted = true;
+
+                bool await_ready() {
+                    std::unique_lock<std::mutex> lock(ch.mutex);
+                    if (ch.producers <= 0) {
+                        accepted = false;
+                        return true;
+                    }
+                    // Straight to a waiting receiver, else into the buffer if there is room
+                    if (!ch.receivers.empty()) {
+                        Receiver* r = ch.receivers.front();
+                        ch.receivers.pop_front();
+                        r->value = std::move(value);
+                        lock.unlock();
+                        ch.scheduler.post(r->handle);
+                        return true;
+                    }
+                    if (ch.buffer.size() < ch.capacity) {
+                        ch.buffer.push_back(std::move(value));
+                        return true;
+                    }
+                    return false;
+                }
+                bool await_suspend(std::coroutine_handle<> h) {
+                    std::lock_guard<std::mutex> lock(ch.mutex);
+                    // A receiver may have made room since await_ready
+                    if (ch.buffer.size() < ch.capacity) {
+                        ch.buffer.push_back(std::move(value));
+                        return false;
+                    }
+                    ch.senders.push_back({h, &value, &accepted});
+                    return true;
+                }
+                bool await_resume() const noexcept { return accepted; }
+            };
+            return Awaiter{*this, std::move(value)};
+        }
+
+        // co_await channel.receive() -> the next item, or std::nullopt once closed and drained
+        auto receive() {
+            struct Awaiter {
+                Channel& ch;
+                Receiver self;
+
+                bool await_ready() {
+                    std::lock_guard<std::mutex> lock(ch.mutex);
+                    return ch.takeLocked(self.value) || ch.producers <= 0;
+                }
+                bool await_suspend(std::coroutine_handle<> h) {
+                    std::lock_guard<std::mutex> lock(ch.mutex);
+                    if (ch.takeLocked(self.value) || ch.producers <= 0) return false;
+                    self.handle = h;
+                    ch.receivers.push_back(&self);
+                    return true;
+                }
+                std::optional<T> await_resume() { return std::move(self.value); }
+            };
+            return Awaiter{*this, {}};
+        }
+
+        void close() {
+            std::deque<Receiver*> waiting;
+            std::deque<Sender> rejected;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (--producers > 0) return;
+                waiting.swap(receivers); // the buffer is empty if anyone is waiting
+                rejected.swap(senders);
+            }
+            for (auto* r : waiting) scheduler.post(r->handle);
+            for (auto& s : rejected) {
+                *s.accepted = false;
+                scheduler.post(s.handle);
+            }
+        }
+
+    private:
+        struct Receiver {
+            std::coroutine_handle<> handle;
+            std::optional<T> value;
+        };
+        struct Sender {
+            std::coroutine_handle<> handle;
+            T* value;
+            bool* accepted;
+        };
+
+        CoroScheduler& scheduler;
+        size_t capacity;
+        int producers;
+        std::mutex mutex;
+        std::deque<T> buffer;
+        std::deque<Receiver*> receivers;
+        std::deque<Sender> senders;
+
+        // Pops the oldest item; a blocked sender takes the freed slot and is resumed
+        bool takeLocked(std::optional<T>& out) {
+            if (buffer.empty()) return false;
+            out = std::move(buffer.front());
+            buffer.pop_front();
+            if (!senders.empty()) {
+                Sender s = senders.front();
+                senders.pop_front();
+                buffer.push_back(std::move(*s.value));
+                scheduler.post(s.handle);
+            }
+            return true;
+        }
+    };
+}
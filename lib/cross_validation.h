@@ -0,0 +1,82 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <random>
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#include "network.h"
+#include "evaluator.h"
+#include "sweep.h"
+#include "thread_pool.h"
+#include "image_processing.h"
+
+namespace NN {
+
+    struct CrossValidationResult {
+        std::vector<EvalResult> folds; // held-out score of every fold's model
+        EvalResult total;              // all folds merged (every sample scored exactly once)
+
+        float meanAccuracy() const {
+            float sum = 0.0f;
+            for (auto& f : folds) sum += f.accuracy();
+            return folds.empty() ? 0.0f : sum / folds.size();
+        }
+
+        float stddevAccuracy() const {
+            const float mean = meanAccuracy();
+            float sq = 0.0f;
+            for (auto& f : folds) sq += (f.accuracy() - mean) * (f.accuracy() - mean);
+            return folds.size() > 1 ? std::sqrt(sq / (folds.size() - 1)) : 0.0f;
+        }
+    };
+
+    // k-fold cross-validation of one configuration. Folds are INDEX VIEWS into the single
+    // in-memory dataset: fold f holds out every sample whose shuffled position is f mod k,
+    // trains on the rest, and no Image is ever copied.
+    //
+    // The k folds train at the same time (one ThreadPool task each), so with k free cores
+    // the whole cross-validation takes about as long as one training run.
+    inline CrossValidationResult crossValidate(const std::vector<ImgProc::Image>& dataset, const SweepConfig& config,
+                                               int k, size_t samplesPerFold) {
+        CrossValidationResult result;
+        if (k < 2 || dataset.size() < static_cast<size_t>(k)) {
+            std::cerr << "Error: cross-validation needs k >= 2 and at least k samples." << std::endl;
+            return result;
+        }
+
+        // 1. Split
+        std::random_device rd;
+        std::mt19937 rng(rd());
+        std::vector<size_t> shuffled(dataset.size());
+        for (size_t i = 0; i < shuffled.size(); i++) shuffled[i] = i;
+        std::shuffle(shuffled.begin(), shuffled.end(), rng);
+
+        std::vector<std::vector<size_t>> heldOut(k);
+        for (size_t i = 0; i < shuffled.size(); i++) heldOut[i % k].push_back(shuffled[i]);
+
+        std::vector<std::unique_ptr<Trial>> trials;
+        for (int f = 0; f < k; f++) {
+            std::vector<size_t> trainIdx;
+            trainIdx.reserve(dataset.size() - heldOut[f].size());
+            for (int g = 0; g < k; g++) {
+                if (g != f) trainIdx.insert(trainIdx.end(), heldOut[g].begin(), heldOut[g].end());
+            }
+            trials.push_back(std::make_unique<Trial>(config, std::move(trainIdx), rd()));
+        }
+
+        // 2. Train + score every fold in parallel
+        result.folds.resize(k);
+        ThreadPool::instance().parallelFor(0, k, 1, [&](size_t lo, size_t hi) {
+            for (size_t f = lo; f < hi; f++) {
+                trainTrial(*trials[f], dataset, samplesPerFold);
+                result.folds[f] = evaluate(trials[f]->net, dataset, heldOut[f]);
+            }
+        });
+
+        for (auto& f : result.folds) result.total.merge(f);
+        return result;
+    }
+}
@@ -0,0 +1,229 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <atomic>
+#include <algorithm>
+#include <iostream>
+#include <cstring>
+#include <cstdint>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "thread_pool.h"
+#include "mapped_file.h"
+#include "idx.h"
+#include "image_processing.h"
+
+namespace ImgProc {
+
+    // COMPACT LAYOUT: one byte per pixel and per label, all samples back to back.
+    // 60000 MNIST images take 47 MB here instead of ~190 MB of float vectors, and a sample
+    // is one pointer offset away. toImages() expands to the float layout the network trains on.
+    struct PackedDataset {
+        size_t count = 0;
+        uint32_t sampleSize = 0;      // bytes (pixels) per sample
+        std::vector<uint8_t> pixels;  // [count][sampleSize], 0-255
+        std::vector<uint8_t> labels;  // [count]
+
+        const uint8_t* sample(size_t i) const { return pixels.data() + i * sampleSize; }
+        bool empty() const { return count == 0; }
+
+        // Same result as MnistLoader::load: pixels / 255, one-hot over max(10, labels) classes
+        std::vector<Image> toImages() const {
+            std::vector<Image> dataset(count);
+            int classes = 10;
+            for (uint8_t l : labels) classes = std::max(classes, l + 1);
+
+            NN::ThreadPool::instance().parallelFor(0, count, 1024, [&](size_t lo, size_t hi) {
+                for (size_t i = lo; i < hi; i++) {
+                    Image& img = dataset[i];
+                    img.label = labels[i];
+                    img.target.assign(classes, 0.0f);
+                    img.target[img.label] = 1.0f;
+                    const uint8_t* src = sample(i);
+                    img.pixels.resize(sampleSize);
+                    for (uint32_t j = 0; j < sampleSize; j++) img.pixels[j] = static_cast<float>(src[j]) / 255.0f;
+                }
+            });
+            return dataset;
+        }
+
+        // u8 IDX image/label pair into the same layout (mmap + copy)
+        static PackedDataset loadIdx(const std::string& imagePath, const std::string& labelPath) {
+            PackedDataset data;
+            NN::IdxFile img, lbl;
+            if (!img.open(imagePath) || !lbl.open(labelPath)) return data;
+            if (img.header().type != NN::IdxType::U8 || lbl.header().type != NN::IdxType::U8 ||
+                lbl.header().rank() != 1 || img.records() != lbl.records()) {
+                std::cerr << "Error: Expected u8 images and labels with matching counts." << std::endl;
+                return data;
+            }
+            data.count = img.records();
+            data.sampleSize = static_cast<uint32_t>(img.header().recordElements());
+            data.pixels.assign(img.raw(0), img.raw(0) + data.count * data.sampleSize);
+            data.labels.assign(lbl.raw(0), lbl.raw(0) + data.count);
+            return data;
+        }
+    };
+
+    // Multi-threaded CSV ingestion: rows of "label,p0,p1,...,p{n-1}" with 0-255 integers,
+    // an optional header row, LF or CRLF line ends.
+    //
+    // The file is mapped and cut into chunks at line boundaries. Pass 1 counts the rows of
+    // every chunk in parallel (memchr over the mapping), a prefix sum gives each chunk its
+    // first row, and pass 2 parses all chunks in parallel straight into their rows of the
+    // packed layout: no per-line strings, no intermediate copies.
+    //
+    // COST: still text parsing. On one core the 110 MB MNIST train CSV takes ~160 ms against
+    // ~25 ms for the IDX copy (about 6x); both passes split over the pool's threads.
+    class CsvLoader {
+    public:
+        static PackedDataset load(const std::string& path, uint32_t sampleSize = 784) {
+            PackedDataset data;
+            NN::MappedFile file;
+            if (!file.open(path)) return data;
+
+            const char* begin = file.data();
+            const char* end = begin + file.size();
+            if (begin < end && !isDigit(*begin)) begin = nextLine(begin, end); // header row
+
+            // 1. Chunk boundaries, each just after a '\n'
+            NN::ThreadPool& pool = NN::ThreadPool::instance();
+            const size_t chunks = std::max<size_t>(1, std::min<size_t>(pool.size() * 4, (end - begin) / (1 << 20) + 1));
+            std::vector<const char*> bounds(chunks + 1);
+            bounds[0] = begin;
+            bounds[chunks] = end;
+            for (size_t c = 1; c < chunks; c++) {
+                const char* guess = begin + (end - begin) * c / chunks;
+                bounds[c] = std::max(bounds[c - 1], nextLine(guess, end));
+            }
+
+            // 2. Rows per chunk, then where each chunk's rows start
+            std::vector<size_t> firstRow(chunks + 1, 0);
+            pool.parallelFor(0, chunks, 1, [&](size_t lo, size_t hi) {
+                for (size_t c = lo; c < hi; c++) firstRow[c + 1] = countRows(bounds[c], bounds[c + 1]);
+            });
+            for (size_t c = 0; c < chunks; c++) firstRow[c + 1] += firstRow[c];
+
+            data.count = firstRow[chunks];
+            data.sampleSize = sampleSize;
+            data.pixels.resize(data.count * sampleSize);
+            data.labels.resize(data.count);
+
+            // 3. Parse every chunk into its rows
+            std::atomic<size_t> badRow{SIZE_MAX};
+            pool.parallelFor(0, chunks, 1, [&](size_t lo, size_t hi) {
+                for (size_t c = lo; c < hi; c++) {
+                    size_t row = firstRow[c];
+                    const char* p = bounds[c];
+                    while (p < bounds[c + 1]) {
+                        const char* lineEnd = static_cast<const char*>(std::memchr(p, '\n', bounds[c + 1] - p));
+                        if (!lineEnd) lineEnd = bounds[c + 1];
+                        if (!isBlank(p, lineEnd)) {
+                            if (!parseRow(p, lineEnd, sampleSize, &data.pixels[row * sampleSize], data.labels[row])) {
+                                size_t expected = SIZE_MAX;
+                                while (row < expected && !badRow.compare_exchange_weak(expected, row)) {}
+                                break;
+                            }
+                            row++;
+                        }
+                        p = lineEnd + 1;
+                    }
+                }
+            });
+
+            if (badRow.load() != SIZE_MAX) {
+                std::cerr << "Error: " << path << ": data row " << badRow.load() + 1 << " is not a label followed by "
+                          << sampleSize << " values 0-255" << std::endl;
+                return PackedDataset();
+            }
+            return data;
+        }
+
+        // Straight to the float layout the network trains on
+        static std::vector<Image> loadImages(const std::string& path, uint32_t sampleSize = 784) {
+            return load(path, sampleSize).toImages();
+        }
+
+    private:
+        static constexpr char zeroRun[17] = ",0,0,0,0,0,0,0,0";
+
+        static bool isDigit(char c) { return c >= '0' && c <= '9'; }
+
+        static const char* nextLine(const char* p, const char* end) {
+            const char* nl = static_cast<const char*>(std::memchr(p, '\n', end - p));
+            return nl ? nl + 1 : end;
+        }
+
+        // Empty or "\r" only
+        static bool isBlank(const char* p, const char* lineEnd) {
+            return p == lineEnd || (p + 1 == lineEnd && *p == '\r');
+        }
+
+        static size_t countRows(const char* p, const char* end) {
+            size_t rows = 0;
+            while (p < end) {
+                const char* lineEnd = static_cast<const char*>(std::memchr(p, '\n', end - p));
+                if (!lineEnd) lineEnd = end;
+                if (!isBlank(p, lineEnd)) rows++;
+                p = lineEnd + 1;
+            }
+            return rows;
+        }
+
+        // One 0-255 field: digits until a non-digit, giving up as soon as the value passes 255
+        // (cheaper than a general std::from_chars for fields of at most three digits)
+        static bool parseByte(const char*& p, const char* end, uint8_t& out) {
+            const char* start = p;
+            unsigned value = 0;
+            while (p < end && isDigit(*p)) {
+                value = value * 10 + static_cast<unsigned>(*p - '0');
+                if (value > 255) return false;
+                p++;
+            }
+            out = static_cast<uint8_t>(value);
+            return p != start;
+        }
+
+        // How many complete ",0" fields (at most 8 and `limit`) start at p. A "0" followed by
+        // another digit is not counted, so the general parser still sees (and checks) it.
+        static uint32_t zeroFields(const char* p, const char* end, uint32_t limit) {
+            if (end - p <= 16) return 0; // p[16] is read below
+            uint32_t pairs = 0;
+#if defined(__SSE2__)
+            // 1. Byte mask of p[0..16) == ",0,0,...", then the number of leading matching pairs
+            const __m128i text = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+            const __m128i pattern = _mm_loadu_si128(reinterpret_cast<const __m128i*>(zeroRun));
+            const unsigned match = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(text, pattern)));
+            pairs = static_cast<uint32_t>(__builtin_ctz(~match | 0x10000u)) / 2;
+#else
+            if (std::memcmp(p, zeroRun, 16) == 0) pairs = 8;
+#endif
+            // 2. Not past the row, and the last field must end where its "0" does
+            pairs = std::min(pairs, limit);
+            while (pairs > 0 && isDigit(p[2 * pairs])) pairs--;
+            return pairs;
+        }
+
+        static bool parseRow(const char* p, const char* end, uint32_t sampleSize, uint8_t* pixels, uint8_t& label) {
+            if (end > p && end[-1] == '\r') end--;
+            if (!parseByte(p, end, label)) return false;
+            for (uint32_t j = 0; j < sampleSize; j++) {
+                // Most MNIST pixels are background: a run of ",0" fields is skipped in one step
+                if (const uint32_t zeros = zeroFields(p, end, sampleSize - j)) {
+                    std::memset(pixels + j, 0, zeros);
+                    p += 2 * zeros;
+                    j += zeros - 1;
+                    continue;
+                }
+                if (p >= end || *p != ',') return false;
+                p++;
+                if (!parseByte(p, end, pixels[j])) return false;
+            }
+            return p == end;
+        }
+    };
+}
@@ -0,0 +1,510 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <iostream>
+#include <cstring>
+#include <cerrno>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "network.h"
+#include "gradients.h"
+#include "compression.h"
+#include "kernels.h"
+#include "image_processing.h"
+
+namespace NN {
+
+    // Ring of worker processes. Rank r listens on its own address, connects to rank r+1 and
+    // accepts rank r-1, so every process has exactly one outgoing and one incoming socket.
+    //
+    // ADDRESSES:
+    //   unix:/tmp/nn_ring            rank r listens on /tmp/nn_ring.<r>     (one host)
+    //   tcp:127.0.0.1:29500          rank r listens on port 29500 + r       (one host)
+    //   tcp:hostA,hostB,hostC:29500  rank r runs on host r (last host repeats if the list is short)
+    class RingCommunicator {
+    public:
+        int rank;
+        int worldSize;
+        std::string address;
+        size_t bytesSent = 0; // payload written to the next rank so far
+
+        RingCommunicator(int r, int world, const std::string& addr) : rank(r), worldSize(world), address(addr) {}
+
+        ~RingCommunicator() { close(); }
+
+        RingCommunicator(const RingCommunicator&) = delete;
+        RingCommunicator& operator=(const RingCommunicator&) = delete;
+
+        bool connect() {
+            if (worldSize <= 1) return true;
+
+            listenFd = listenOn(rank);
+            if (listenFd < 0) return false;
+
+            // The next rank may not be listening yet: retry for a while
+            const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(30);
+            while ((nextFd = connectTo((rank + 1) % worldSize)) < 0) {
+                if (std::chrono::steady_clock::now() > deadline) {
+                    std::cerr << "Error: rank " << rank << " could not reach rank " << (rank + 1) % worldSize << std::endl;
+                    return false;
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            }
+            // Same deadline for the previous rank: if it died, accept() would block forever
+            pollfd incoming{listenFd, POLLIN, 0};
+            if (::poll(&incoming, 1, 30000) <= 0) {
+                std::cerr << "Error: rank " << rank << " was never reached by rank " << mod(rank - 1, worldSize) << std::endl;
+                return false;
+            }
+            prevFd = ::accept(listenFd, nullptr, nullptr);
+            if (prevFd < 0) {
+                std::cerr << "Error: rank " << rank << " accept failed: " << std::strerror(errno) << std::endl;
+                return false;
+            }
+            setNonBlocking(nextFd);
+            setNonBlocking(prevFd);
+            return true;
+        }
+
+        void close() {
+            for (int* fd : {&nextFd, &prevFd, &listenFd}) {
+                if (*fd >= 0) ::close(*fd);
+                *fd = -1;
+            }
+            if (isUnix() && !unixPath.empty()) ::unlink(unixPath.c_str());
+        }
+
+        // Bandwidth-optimal ring all-reduce (sum), in place. The buffer is cut into worldSize
+        // chunks; reduce-scatter then all-gather, each worldSize-1 steps. Every process sends
+        // and receives 2 * (W-1)/W * n floats in total, independent of the number of processes.
+        bool allReduce(float* data, size_t n) {
+            if (worldSize <= 1 || n == 0) return true;
+            const int W = worldSize;
+            auto chunkBegin = [&](int c) { return n * static_cast<size_t>(c) / W; };
+            auto chunkSize = [&](int c) { return chunkBegin(c + 1) - chunkBegin(c); };
+            scratch.resize(chunkSize(0) + 1);
+
+            // 1. Reduce-scatter: after this, rank r owns the full sum of chunk (r + 1) % W
+            for (int s = 0; s < W - 1; s++) {
+                int sendChunk = mod(rank - s, W);
+                int recvChunk = mod(rank - s - 1, W);
+                scratch.resize(std::max(scratch.size(), chunkSize(recvChunk)));
+                if (!exchange(data + chunkBegin(sendChunk), chunkSize(sendChunk), scratch.data(), chunkSize(recvChunk))) return false;
+                float* dst = data + chunkBegin(recvChunk);
+                for (size_t i = 0; i < chunkSize(recvChunk); i++) dst[i] += scratch[i];
+            }
+
+            // 2. All-gather: pass the finished chunks around the ring
+            for (int s = 0; s < W - 1; s++) {
+                int sendChunk = mod(rank + 1 - s, W);
+                int recvChunk = mod(rank - s, W);
+                if (!exchange(data + chunkBegin(sendChunk), chunkSize(sendChunk), data + chunkBegin(recvChunk), chunkSize(recvChunk))) return false;
+            }
+            return true;
+        }
+
+        // Every rank ends up with every rank's message (all[r] = rank r's), passed W-1 hops
+        // around the ring. Messages may differ in size, so each hop sends its length first.
+        bool allGather(const std::vector<uint8_t>& mine, std::vector<std::vector<uint8_t>>& all) {
+            all.resize(worldSize);
+            all[rank] = mine;
+            for (int s = 0; s < worldSize - 1; s++) {
+                const int sendFrom = mod(rank - s, worldSize);
+                const int recvFrom = mod(rank - s - 1, worldSize);
+                uint64_t sendLen = all[sendFrom].size();
+                uint64_t recvLen = 0;
+                if (!exchangeBytes(&sendLen, sizeof(sendLen), &recvLen, sizeof(recvLen))) return false;
+                all[recvFrom].resize(recvLen);
+                if (!exchangeBytes(all[sendFrom].data(), sendLen, all[recvFrom].data(), recvLen)) return false;
+            }
+            return true;
+        }
+
+        // Send raw bytes to the next rank while receiving from the previous one. Both sockets are
+        // non-blocking and driven by poll(), so large messages can't deadlock the ring.
+        bool exchangeBytes(const void* sendBuf, size_t sendLen, void* recvBuf, size_t recvLen) {
+            const char* out = static_cast<const char*>(sendBuf);
+            char* in = static_cast<char*>(recvBuf);
+            size_t sent = 0;
+            size_t received = 0;
+
+            while (sent < sendLen || received < recvLen) {
+                pollfd fds[2];
+                int count = 0;
+                int sendIdx = -1;
+                int recvIdx = -1;
+                if (sent < sendLen) {
+                    fds[count] = {nextFd, POLLOUT, 0};
+                    sendIdx = count++;
+                }
+                if (received < recvLen) {
+                    fds[count] = {prevFd, POLLIN, 0};
+                    recvIdx = count++;
+                }
+                if (::poll(fds, count, 30000) <= 0) {
+                    std::cerr << "Error: rank " << rank << " ring timed out" << std::endl;
+                    return false;
+                }
+                if (sendIdx >= 0 && (fds[sendIdx].revents & (POLLOUT | POLLERR | POLLHUP))) {
+                    ssize_t k = ::send(nextFd, out + sent, sendLen - sent, MSG_NOSIGNAL);
+                    if (k < 0 && errno != EAGAIN && errno != EWOULDBLOCK) return fail("send");
+                    if (k > 0) {
+                        sent += k;
+                        bytesSent += k;
+                    }
+                }
+                if (recvIdx >= 0 && (fds[recvIdx].revents & (POLLIN | POLLERR | POLLHUP))) {
+                    ssize_t k = ::recv(prevFd, in + received, recvLen - received, 0);
+                    if (k == 0) return fail("peer closed");
+                    if (k < 0 && errno != EAGAIN && errno != EWOULDBLOCK) return fail("recv");
+                    if (k > 0) received += k;
+                }
+            }
+            return true;
+        }
+
+    private:
+        int listenFd = -1;
+        int nextFd = -1;
+        int prevFd = -1;
+        std::string unixPath;
+        std::vector<float> scratch;
+
+        static int mod(int a, int m) { return ((a % m) + m) % m; }
+
+        bool exchange(const float* sendBuf, size_t sendCount, float* recvBuf, size_t recvCount) {
+            return exchangeBytes(sendBuf, sendCount * sizeof(float), recvBuf, recvCount * sizeof(float));
+        }
+
+        bool fail(const char* what) {
+            std::cerr << "Error: rank " << rank << " " << what << ": " << std::strerror(errno) << std::endl;
+            return false;
+        }
+
+        bool isUnix() const { return address.rfind("unix:", 0) == 0; }
+
+        std::string unixPathFor(int r) const { return address.substr(5) + "." + std::to_string(r); }
+
+        // "tcp:h0,h1:port" -> host of rank r, port + r
+        void tcpEndpoint(int r, std::string& host, int& port) const {
+            std::string spec = address.substr(4);
+            size_t colon = spec.rfind(':');
+            port = std::stoi(spec.substr(colon + 1)) + r;
+            std::vector<std::string> hosts;
+            std::string list = spec.substr(0, colon);
+            size_t pos = 0;
+            while (true) {
+                size_t comma = list.find(',', pos);
+                hosts.push_back(list.substr(pos, comma - pos));
+                if (comma == std::string::npos) break;
+                pos = comma + 1;
+            }
+            host = hosts[std::min<size_t>(r, hosts.size() - 1)];
+        }
+
+        static void setNonBlocking(int fd) {
+            ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+        }
+
+        int listenOn(int r) {
+            if (isUnix()) {
+                unixPath = unixPathFor(r);
+                ::unlink(unixPath.c_str());
+                int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+                sockaddr_un addr{};
+                addr.sun_family = AF_UNIX;
+                std::strncpy(addr.sun_path, unixPath.c_str(), sizeof(addr.sun_path) - 1);
+                if (fd < 0 || ::bind(fd, (sockaddr*)&addr, sizeof(addr)) < 0 || ::listen(fd, 4) < 0) {
+                    fail("listen");
+                    if (fd >= 0) ::close(fd);
+                    return -1;
+                }
+                return fd;
+            }
+
+            std::string host;
+            int port;
+            tcpEndpoint(r, host, port);
+            int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+            int one = 1;
+            ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+            sockaddr_in addr{};
+            addr.sin_family = AF_INET;
+            addr.sin_addr.s_addr = htonl(INADDR_ANY);
+            addr.sin_port = htons(port);
+            if (fd < 0 || ::bind(fd, (sockaddr*)&addr, sizeof(addr)) < 0 || ::listen(fd, 4) < 0) {
+                fail("listen");
+                if (fd >= 0) ::close(fd);
+                return -1;
+            }
+            return fd;
+        }
+
+        int connectTo(int r) {
+            if (isUnix()) {
+                int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+                sockaddr_un addr{};
+                addr.sun_family = AF_UNIX;
+                std::strncpy(addr.sun_path, unixPathFor(r).c_str(), sizeof(addr.sun_path) - 1);
+                if (::connect(fd, (sockaddr*)&addr, sizeof(addr)) < 0) {
+                    ::close(fd);
+                    return -1;
+                }
+                return fd;
+            }
+
+            std::string host;
+            int port;
+            tcpEndpoint(r, host, port);
+            addrinfo hints{};
+            hints.ai_family = AF_INET;
+            hints.ai_socktype = SOCK_STREAM;
+            addrinfo* res = nullptr;
+            if (::getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &res) != 0) return -1;
+            int fd = ::socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+            int ok = (fd >= 0) ? ::connect(fd, res->ai_addr, res->ai_addrlen) : -1;
+            ::freeaddrinfo(res);
+            if (ok < 0) {
+                if (fd >= 0) ::close(fd);
+                return -1;
+            }
+            int one = 1;
+            ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            return fd;
+        }
+    };
+
+    // Synchronous data-parallel SGD across processes. Every process holds a replica of the
+    // network and a shard of the data (sample i goes to rank i % worldSize).
+    //
+    // OVERLAP: the backward pass runs layer by layer over the whole local batch, so as soon as
+    // the last layer's gradients are final they are handed to a communication thread and
+    // all-reduced while the earlier layers are still being differentiated.
+    //
+    // COMPRESSION: with anything but Compression::None each bucket is encoded by a
+    // GradientCompressor (error feedback keeps what it drops) and all-gathered instead of
+    // ring-reduced; every rank then decodes the W messages in rank order, so all replicas
+    // add the same floats in the same order and stay bit-identical.
+    class DistributedTrainer {
+    public:
+        NeuralNetwork& net;
+        RingCommunicator& comm;
+        Compression compression = Compression::None;
+        float topKRatio = 0.01f; // fraction of each bucket top-k keeps
+
+        DistributedTrainer(NeuralNetwork& network, RingCommunicator& communicator) : net(network), comm(communicator) {}
+
+        // Every replica starts from rank 0's weights (everyone else contributes zeros to a sum)
+        bool broadcastWeights() {
+            for (auto& layer : net.layers) {
+                Layer& l = std::get<Layer>(layer);
+                if (comm.rank != 0) {
+                    std::fill(l.weights.begin(), l.weights.end(), 0.0f);
+                    std::fill(l.biases.begin(), l.biases.end(), 0.0f);
+                }
+                if (!comm.allReduce(l.weights.data(), l.weights.size())) return false;
+                if (!comm.allReduce(l.biases.data(), l.biases.size())) return false;
+            }
+            return true;
+        }
+
+        // `batchSize` is per process; the effective batch is batchSize * worldSize
+        bool train(const std::vector<ImgProc::Image>& dataset, int epochs, int batchSize, float learningRate) {
+            if (!supportsGradients(net)) {
+                std::cerr << "Error: DistributedTrainer only supports dense layers." << std::endl;
+                return false;
+            }
+            if (batchSize <= 0) {
+                std::cerr << "Error: DistributedTrainer needs a batch size of at least 1." << std::endl;
+                return false;
+            }
+            if (!broadcastWeights()) return false;
+
+            // 1. My shard; every rank runs the same number of steps
+            std::vector<const ImgProc::Image*> shard;
+            for (size_t i = comm.rank; i < dataset.size(); i += comm.worldSize) shard.push_back(&dataset[i]);
+            const int steps = static_cast<int>(dataset.size() / comm.worldSize) / batchSize;
+
+            GradientBuffer grads(net);
+            BatchState state(net, batchSize);
+            gradBase = grads.data.data();
+            compressor = std::make_unique<GradientCompressor>(grads.size(), compression, topKRatio);
+            std::mt19937 rng(std::random_device{}() + comm.rank);
+            bool ok = true;
+
+            std::thread commThread([&] { commLoop(); });
+
+            for (int e = 0; e < epochs && ok; e++) {
+                std::shuffle(shard.begin(), shard.end(), rng);
+                float loss = 0.0f;
+
+                for (int step = 0; step < steps && ok; step++) {
+                    grads.zero();
+                    loss += backwardOverlapped(shard, step * batchSize, batchSize, grads, state);
+                    ok = waitForBuckets();
+                    if (!ok) break; // some buckets were never reduced: leave the weights alone
+                    applyGradients(net, grads.data.data(), learningRate / (static_cast<float>(batchSize) * comm.worldSize));
+                }
+
+                // Loss across all processes
+                float total[1] = {loss};
+                if (ok) ok = comm.allReduce(total, 1);
+                if (ok && comm.rank == 0 && steps > 0) { // a shard smaller than one batch trains nothing
+                    std::cout << "Epoch " << (e + 1) << "/" << epochs << " loss "
+                              << total[0] / (static_cast<float>(steps) * batchSize * comm.worldSize)
+                              << " (" << comm.bytesSent / (1024 * 1024) << " MB sent so far)" << std::endl;
+                }
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stop = true;
+            }
+            cv.notify_all();
+            commThread.join();
+            return ok;
+        }
+
+    private:
+        struct Bucket {
+            float* data;
+            size_t size;
+        };
+
+        // Activations / deltas of every sample in the batch, kept for the layer-major backward
+        struct BatchState {
+            std::vector<GradientScratch> samples;
+            BatchState(const NeuralNetwork& net, int batch) : samples(batch, GradientScratch(net)) {}
+        };
+
+        std::unique_ptr<GradientCompressor> compressor;
+        const float* gradBase = nullptr;
+        std::vector<uint8_t> message;
+        std::vector<std::vector<uint8_t>> messages;
+
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::deque<Bucket> queue;
+        size_t enqueued = 0;
+        size_t finished = 0;
+        bool commFailed = false;
+        bool stop = false;
+
+        float backwardOverlapped(const std::vector<const ImgProc::Image*>& shard, int first, int batch,
+                                 GradientBuffer& grads, BatchState& state) {
+            const size_t L = net.layers.size();
+            float loss = 0.0f;
+
+            // 1. Forward every sample, keep the activations
+            for (int b = 0; b < batch; b++) {
+                auto& act = state.samples[b].activations;
+                auto& delta = state.samples[b].deltas;
+                const ImgProc::Image& img = *shard[first + b];
+                std::copy(img.pixels.begin(), img.pixels.end(), act[0].begin());
+                for (size_t i = 0; i < L; i++) {
+                    const Layer& l = std::get<Layer>(net.layers[i]);
+                    Kernels::denseForward(act[i].data(), l.weights.data(), l.biases.data(), act[i + 1].data(),
+                                          l.numNodesIn, l.numNodesOut, l.actType);
+                }
+                for (size_t o = 0; o < act[L].size(); o++) {
+                    float d = act[L][o] - img.target[o];
+                    delta[L][o] = d;
+                    loss += 0.5f * d * d;
+                }
+            }
+
+            // 2. Backward, LAYER-major: once layer i is done for every sample, ship its bucket
+            for (size_t i = L; i-- > 0;) {
+                const Layer& l = std::get<Layer>(net.layers[i]);
+                for (int b = 0; b < batch; b++) {
+                    auto& act = state.samples[b].activations;
+                    auto& delta = state.samples[b].deltas;
+                    Kernels::activationDelta(delta[i + 1].data(), act[i + 1].data(), delta[i + 1].data(), l.numNodesOut, l.actType);
+                    Kernels::denseParamGradients(act[i].data(), delta[i + 1].data(), grads.weights(i), grads.biases(i),
+                                                 l.numNodesIn, l.numNodesOut);
+                    if (i > 0) {
+                        std::fill(delta[i].begin(), delta[i].end(), 0.0f);
+                        Kernels::denseInputGradients(delta[i + 1].data(), l.weights.data(), delta[i].data(), l.numNodesIn, l.numNodesOut);
+                    }
+                }
+                // [dW_i | db_i] is one contiguous range of the buffer
+                enqueue({grads.weights(i), l.weights.size() + l.biases.size()});
+            }
+            return loss;
+        }
+
+        void enqueue(Bucket bucket) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                queue.push_back(bucket);
+                enqueued++;
+            }
+            cv.notify_all();
+        }
+
+        // Waits for EVERY bucket, also after a failure: until then the comm thread may still
+        // be writing into the gradient buffer
+        bool waitForBuckets() {
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait(lock, [&] { return finished == enqueued; });
+            return !commFailed;
+        }
+
+        // Buckets are reduced in the order they were produced, which is the same on every rank
+        void commLoop() {
+            while (true) {
+                Bucket bucket;
+                bool failed;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    cv.wait(lock, [&] { return stop || !queue.empty(); });
+                    if (queue.empty()) return;
+                    bucket = queue.front();
+                    queue.pop_front();
+                    failed = commFailed;
+                }
+                // After a failure the ring is out of step: the rest is dropped, not reduced
+                bool ok = !failed && ((compression == Compression::None) ? comm.allReduce(bucket.data, bucket.size)
+                                                                         : compressedAllReduce(bucket));
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    finished++;
+                    if (!ok) commFailed = true;
+                }
+                cv.notify_all();
+            }
+        }
+
+        bool compressedAllReduce(const Bucket& bucket) {
+            compressor->encode(bucket.data, bucket.size, bucket.data - gradBase, message);
+            if (!comm.allGather(message, messages)) return false;
+            std::fill(bucket.data, bucket.data + bucket.size, 0.0f);
+            for (size_t r = 0; r < messages.size(); r++) {
+                // A malformed message fails the step like a failed exchange does
+                if (!compressor->decodeAdd(messages[r], bucket.data, bucket.size)) {
+                    std::cerr << "Error: rank " << r << " sent a malformed gradient message" << std::endl;
+                    return false;
+                }
+            }
+            return true;
+        }
+    };
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <random>
+#include <fstream>
+
+namespace NN {
+
+    // Inverted Dropout: while training, zero each input with probability `rate` and
+    // scale the survivors by 1/(1-rate), so inference is a plain pass-through.
+    class DropoutLayer {
+    public:
+        static constexpr char tag = 'o';
+
+        int size;
+        float rate;
+        bool training = false; // Set by NeuralNetwork::train
+
+        std::vector<uint8_t> lastMask;
+        std::mt19937 gen;
+
+        DropoutLayer(int n, float r)
+        : size(n), rate(r), gen(std::random_device{}()) {}
+
+        // 1. FORWARD PASS
+        std::vector<float> calculateOutput(const std::vector<float>& inputs) {
+            if (!training || rate <= 0.0f) return inputs;
+
+            std::bernoulli_distribution keep(1.0f - rate);
+            const float scale = 1.0f / (1.0f - rate);
+            lastMask.resize(size);
+            std::vector<float> outputs(size);
+            for (int i = 0; i < size; i++) {
+                lastMask[i] = keep(gen) ? 1 : 0;
+                outputs[i] = lastMask[i] ? inputs[i] * scale : 0.0f;
+            }
+            return outputs;
+        }
+
+        // Inference only: dropout is a pass-through
+        std::vector<float> infer(const std::vector<float>& inputs) const {
+            return inputs;
+        }
+
+        // 2. BACKWARD PASS
+        std::vector<float> backPropagate(const std::vector<float>& outputGradients, float /*learningRate*/, float /*l1*/ = 0.0f) {
+            if (!training || rate <= 0.0f) return outputGradients;
+
+            const float scale = 1.0f / (1.0f - rate);
+            std::vector<float> inputGradients(size);
+            for (int i = 0; i < size; i++) {
+                inputGradients[i] = lastMask[i] ? outputGradients[i] * scale : 0.0f;
+            }
+            return inputGradients;
+        }
+
+        void write(std::ostream& file) const {
+            file.write((char*)&size, sizeof(int));
+            file.write((char*)&rate, sizeof(float));
+        }
+
+        static DropoutLayer read(std::istream& file) {
+            int n;
+            float r;
+            file.read((char*)&n, sizeof(int));
+            file.read((char*)&r, sizeof(float));
+            return DropoutLayer(n, r);
+        }
+    };
+}
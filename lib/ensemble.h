@@ -0,0 +1,263 @@
+#pragma once
+
+#include <vector>
+#include <variant>
+#include <algorithm>
+#include <iostream>
+
+#include "network.h"
+#include "kernels.h"
+#include "thread_pool.h"
+
+namespace NN {
+
+    // K dense NeuralNetworks with the same topology, trained and run as ONE model.
+    //
+    // STACKING: every member sees the same input, so their first layers are glued side by
+    // side into one [in][K * out] matrix. The K first-layer products become one wide GEMV
+    // (one GEMM per block of samples in predictBatch): the input is read once and there is
+    // one kernel call instead of K. The remaining layers are block-diagonal, so they stay
+    // per member but live packed in one buffer per layer:
+    //     layer 0:  W[i][k * out + o]        layers > 0:  W[k][i][o]      biases: b[k][o]
+    //
+    // INFERENCE: the averaging is fused into the last layer; the K member outputs are never
+    // materialised as separate vectors.
+    //
+    // Each member trains exactly as NeuralNetwork::train would on the same samples
+    // (member(k) gives it back as a normal network).
+    class FusedEnsemble {
+    public:
+        int members;
+        std::vector<int> sizes;                    // topology shared by every member
+        std::vector<ActivationType> activations;   // per layer
+        std::vector<std::vector<float>> weights;   // per layer, stacked as above
+        std::vector<std::vector<float>> biases;    // per layer, [K][out]
+
+        // Packs existing networks (they must be dense and share one topology)
+        explicit FusedEnsemble(const std::vector<NeuralNetwork>& nets) : members(static_cast<int>(nets.size())) {
+            if (nets.empty()) return;
+            for (auto& net : nets) {
+                if (!sameTopology(net, nets.front())) {
+                    std::cerr << "Error: FusedEnsemble needs dense networks with identical topology." << std::endl;
+                    members = 0;
+                    return;
+                }
+            }
+
+            const auto& first = nets.front();
+            sizes.push_back(std::get<Layer>(first.layers.front()).numNodesIn);
+            for (auto& layer : first.layers) {
+                const Layer& l = std::get<Layer>(layer);
+                sizes.push_back(l.numNodesOut);
+                activations.push_back(l.actType);
+            }
+
+            const int K = members;
+            for (size_t li = 0; li + 1 < sizes.size(); li++) {
+                const int nIn = sizes[li];
+                const int nOut = sizes[li + 1];
+                std::vector<float> W(static_cast<size_t>(K) * nIn * nOut);
+                std::vector<float> b(static_cast<size_t>(K) * nOut);
+                for (int k = 0; k < K; k++) {
+                    const Layer& l = std::get<Layer>(nets[k].layers[li]);
+                    for (int i = 0; i < nIn; i++) {
+                        for (int o = 0; o < nOut; o++) W[weightIndex(li, k, i, o)] = l.weights[i * nOut + o];
+                    }
+                    std::copy(l.biases.begin(), l.biases.end(), b.begin() + static_cast<size_t>(k) * nOut);
+                }
+                weights.push_back(std::move(W));
+                biases.push_back(std::move(b));
+            }
+            allocateScratch();
+        }
+
+        // K freshly initialised members
+        FusedEnsemble(const std::vector<int>& topology, int k) : FusedEnsemble(freshMembers(topology, k)) {}
+
+        int numLayers() const { return static_cast<int>(weights.size()); }
+
+        // Unpacks member k into a normal network (e.g. to save it)
+        NeuralNetwork member(int k) const {
+            NeuralNetwork net(sizes);
+            for (int li = 0; li < numLayers(); li++) {
+                Layer& l = std::get<Layer>(net.layers[li]);
+                l.actType = activations[li];
+                const int nIn = sizes[li];
+                const int nOut = sizes[li + 1];
+                for (int i = 0; i < nIn; i++) {
+                    for (int o = 0; o < nOut; o++) l.weights[i * nOut + o] = weights[li][weightIndex(li, k, i, o)];
+                }
+                std::copy(biases[li].begin() + static_cast<size_t>(k) * nOut,
+                          biases[li].begin() + static_cast<size_t>(k + 1) * nOut, l.biases.begin());
+            }
+            return net;
+        }
+
+        // One SGD step of every member on the same sample (MSE, like NeuralNetwork::train)
+        void train(const std::vector<float>& inputs, const std::vector<float>& targets, float learningRate, float l1 = 0.0f) {
+            const int K = members;
+            const int L = numLayers();
+
+            // 1. FORWARD PASS (layer 0 fused, the rest per member)
+            std::copy(inputs.begin(), inputs.end(), acts[0].begin());
+            Kernels::parallelDenseForward(acts[0].data(), weights[0].data(), biases[0].data(), acts[1].data(),
+                                          sizes[0], K * sizes[1], activations[0]);
+            for (int li = 1; li < L; li++) memberForward(li, acts[li].data(), acts[li + 1].data());
+
+            // 2. Loss gradient, the same target for everyone
+            const int nLast = sizes[L];
+            for (int k = 0; k < K; k++) {
+                for (int o = 0; o < nLast; o++) grads[L][k * nLast + o] = acts[L][k * nLast + o] - targets[o];
+            }
+
+            // 3. BACKWARD PASS (Loop reversed)
+            for (int li = L - 1; li >= 1; li--) {
+                const int nIn = sizes[li];
+                const int nOut = sizes[li + 1];
+                std::fill(grads[li].begin(), grads[li].end(), 0.0f);
+                for (int k = 0; k < K; k++) {
+                    float* W = &weights[li][static_cast<size_t>(k) * nIn * nOut];
+                    float* b = &biases[li][static_cast<size_t>(k) * nOut];
+                    float* delta = &deltas[li + 1][static_cast<size_t>(k) * nOut];
+                    Kernels::activationDelta(&grads[li + 1][k * nOut], &acts[li + 1][k * nOut], delta, nOut, activations[li]);
+                    Kernels::denseInputGradients(delta, W, &grads[li][k * nIn], nIn, nOut);
+                    Kernels::denseSgdUpdate(&acts[li][k * nIn], delta, W, b, nIn, nOut, learningRate, l1);
+                }
+            }
+            // Layer 0: one fused update of the stacked matrix (nobody needs dC/dInput)
+            Kernels::parallelActivationDelta(grads[1].data(), acts[1].data(), deltas[1].data(), K * sizes[1], activations[0]);
+            Kernels::parallelDenseSgdUpdate(acts[0].data(), deltas[1].data(), weights[0].data(), biases[0].data(),
+                                            sizes[0], K * sizes[1], learningRate, l1);
+        }
+
+        // Mean of the members' outputs
+        std::vector<float> predict(const std::vector<float>& inputs) const {
+            std::vector<float> outputs(sizes.back(), 0.0f);
+            std::vector<float> first(static_cast<size_t>(members) * sizes[1]);
+            Kernels::denseForward(inputs.data(), weights[0].data(), biases[0].data(), first.data(),
+                                  sizes[0], members * sizes[1], activations[0]);
+            finishSample(first.data(), outputs.data());
+            return outputs;
+        }
+
+        // Many samples: blocks of `block` samples share every row of the stacked first layer
+        // (a small GEMM, the row is loaded once per block), blocks run on the shared pool.
+        std::vector<std::vector<float>> predictBatch(const std::vector<std::vector<float>>& inputs) const {
+            constexpr size_t block = 8;
+            std::vector<std::vector<float>> outputs(inputs.size(), std::vector<float>(sizes.back(), 0.0f));
+            const int nIn = sizes[0];
+            const int wide = members * sizes[1];
+
+            const size_t numBlocks = (inputs.size() + block - 1) / block;
+            ThreadPool::instance().parallelFor(0, numBlocks, 1, [&](size_t lo, size_t hi) {
+                std::vector<float> first(block * wide);
+                for (size_t blk = lo; blk < hi; blk++) {
+                    const size_t s0 = blk * block;
+                    const size_t count = std::min(block, inputs.size() - s0);
+
+                    for (size_t s = 0; s < count; s++) std::copy(biases[0].begin(), biases[0].end(), &first[s * wide]);
+                    for (int i = 0; i < nIn; i++) {
+                        const float* row = &weights[0][static_cast<size_t>(i) * wide];
+                        for (size_t s = 0; s < count; s++) {
+                            const float x = inputs[s0 + s][i];
+                            if (x == 0.0f) continue;
+                            float* out = &first[s * wide];
+                            for (int o = 0; o < wide; o++) out[o] += x * row[o];
+                        }
+                    }
+                    for (size_t s = 0; s < count; s++) {
+                        float* out = &first[s * wide];
+                        for (int o = 0; o < wide; o++) out[o] = activate(activations[0], out[o]);
+                        finishSample(out, outputs[s0 + s].data());
+                    }
+                }
+            });
+            return outputs;
+        }
+
+    private:
+        // MEMORY: per-layer activations, upstream gradients and deltas of ALL members ([K][n])
+        std::vector<std::vector<float>> acts;
+        std::vector<std::vector<float>> grads;
+        std::vector<std::vector<float>> deltas;
+
+        static bool sameTopology(const NeuralNetwork& a, const NeuralNetwork& b) {
+            if (a.layers.empty() || a.layers.size() != b.layers.size()) return false;
+            for (size_t i = 0; i < a.layers.size(); i++) {
+                const Layer* la = std::get_if<Layer>(&a.layers[i]);
+                const Layer* lb = std::get_if<Layer>(&b.layers[i]);
+                if (!la || !lb || la->numNodesIn != lb->numNodesIn || la->numNodesOut != lb->numNodesOut ||
+                    la->actType != lb->actType) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        static std::vector<NeuralNetwork> freshMembers(const std::vector<int>& topology, int k) {
+            std::vector<NeuralNetwork> nets;
+            for (int i = 0; i < k; i++) nets.emplace_back(topology);
+            return nets;
+        }
+
+        size_t weightIndex(size_t layer, int k, int i, int o) const {
+            const size_t nIn = sizes[layer];
+            const size_t nOut = sizes[layer + 1];
+            if (layer == 0) return i * (members * nOut) + k * nOut + o;
+            return (k * nIn + i) * nOut + o;
+        }
+
+        void allocateScratch() {
+            acts.emplace_back(sizes[0]); // the shared input
+            grads.emplace_back();
+            deltas.emplace_back();
+            for (size_t li = 1; li < sizes.size(); li++) {
+                acts.emplace_back(static_cast<size_t>(members) * sizes[li]);
+                grads.emplace_back(static_cast<size_t>(members) * sizes[li]);
+                deltas.emplace_back(static_cast<size_t>(members) * sizes[li]);
+            }
+        }
+
+        // Layers >= 1 for every member: in = [K][nIn] -> out = [K][nOut]
+        void memberForward(int li, const float* in, float* out) const {
+            const int nIn = sizes[li];
+            const int nOut = sizes[li + 1];
+            for (int k = 0; k < members; k++) {
+                Kernels::denseForward(in + static_cast<size_t>(k) * nIn, &weights[li][static_cast<size_t>(k) * nIn * nOut],
+                                      &biases[li][static_cast<size_t>(k) * nOut], out + static_cast<size_t>(k) * nOut,
+                                      nIn, nOut, activations[li]);
+            }
+        }
+
+        // From the stacked first-layer activations to the averaged output.
+        // Each member's last layer lands in a small buffer and is folded straight into the mean.
+        void finishSample(const float* first, float* mean) const {
+            const int L = numLayers();
+            const int nLast = sizes[L];
+            const float inv = 1.0f / members;
+
+            if (L == 1) {
+                for (int k = 0; k < members; k++) {
+                    for (int o = 0; o < nLast; o++) mean[o] += inv * first[k * nLast + o];
+                }
+                return;
+            }
+
+            std::vector<float> cur;
+            std::vector<float> next;
+            std::vector<float> last(nLast);
+            for (int k = 0; k < members; k++) {
+                cur.assign(first + static_cast<size_t>(k) * sizes[1], first + static_cast<size_t>(k + 1) * sizes[1]);
+                for (int li = 1; li < L; li++) {
+                    const int nIn = sizes[li];
+                    const int nOut = sizes[li + 1];
+                    float* dst = (li == L - 1) ? last.data() : (next.resize(nOut), next.data());
+                    Kernels::denseForward(cur.data(), &weights[li][static_cast<size_t>(k) * nIn * nOut],
+                                          &biases[li][static_cast<size_t>(k) * nOut], dst, nIn, nOut, activations[li]);
+                    if (li != L - 1) cur.swap(next);
+                }
+                for (int o = 0; o < nLast; o++) mean[o] += inv * last[o];
+            }
+        }
+    };
+}
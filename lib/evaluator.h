@@ -0,0 +1,67 @@
+#pragma once
+
+#include <vector>
+#include <mutex>
+#include <algorithm>
+
+#include "network.h"
+#include "thread_pool.h"
+#include "image_processing.h"
+
+namespace NN {
+
+    struct EvalResult {
+        int correct = 0;
+        int total = 0;
+        float loss = 0.0f; // summed 0.5 * (y - t)^2, same as training
+
+        float accuracy() const { return total ? 100.0f * correct / total : 0.0f; }
+        float meanLoss() const { return total ? loss / total : 0.0f; }
+
+        void merge(const EvalResult& other) {
+            correct += other.correct;
+            total += other.total;
+            loss += other.loss;
+        }
+    };
+
+    // Index of the max value
+    inline int argmax(const std::vector<float>& values) {
+        return static_cast<int>(std::distance(values.begin(), std::max_element(values.begin(), values.end())));
+    }
+
+    // Accuracy + loss over data[index(0..count)], in batches on the shared ThreadPool.
+    // Uses NeuralNetwork::predict, so the network itself is never written to.
+    template <class IndexFn>
+    EvalResult evaluateIndexed(const NeuralNetwork& net, const std::vector<ImgProc::Image>& data, size_t count, IndexFn index) {
+        EvalResult result;
+        std::mutex mutex;
+
+        ThreadPool::instance().parallelFor(0, count, 256, [&](size_t lo, size_t hi) {
+            EvalResult local;
+            for (size_t i = lo; i < hi; i++) {
+                const auto& img = data[index(i)];
+                auto output = net.predict(img.pixels);
+                if (argmax(output) == img.label) local.correct++;
+                for (size_t o = 0; o < output.size() && o < img.target.size(); o++) {
+                    float d = output[o] - img.target[o];
+                    local.loss += 0.5f * d * d;
+                }
+                local.total++;
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            result.merge(local);
+        });
+        return result;
+    }
+
+    // Whole dataset
+    inline EvalResult evaluate(const NeuralNetwork& net, const std::vector<ImgProc::Image>& data) {
+        return evaluateIndexed(net, data, data.size(), [](size_t i) { return i; });
+    }
+
+    // Only the samples listed in `indices` (a view, nothing is copied)
+    inline EvalResult evaluate(const NeuralNetwork& net, const std::vector<ImgProc::Image>& data, const std::vector<size_t>& indices) {
+        return evaluateIndexed(net, data, indices.size(), [&](size_t i) { return indices[i]; });
+    }
+}
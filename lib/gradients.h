@@ -0,0 +1,115 @@
+#pragma once
+
+#include <vector>
+#include <variant>
+#include <algorithm>
+#include <iostream>
+
+#include "network.h"
+#include "kernels.h"
+
+namespace NN {
+
+    // One flat float buffer holding dC/dW and dC/db of every dense layer:
+    //     [dW0 | db0 | dW1 | db1 | ...]
+    // Flat, so it can be summed, sent over a socket or compressed as one block.
+    class GradientBuffer {
+    public:
+        std::vector<float> data;
+        std::vector<size_t> weightOffsets;
+        std::vector<size_t> biasOffsets;
+
+        GradientBuffer() = default;
+
+        explicit GradientBuffer(const NeuralNetwork& net) {
+            size_t offset = 0;
+            for (auto& layer : net.layers) {
+                const Layer& l = std::get<Layer>(layer);
+                weightOffsets.push_back(offset);
+                offset += l.weights.size();
+                biasOffsets.push_back(offset);
+                offset += l.biases.size();
+            }
+            data.assign(offset, 0.0f);
+        }
+
+        size_t size() const { return data.size(); }
+        float* weights(size_t layer) { return data.data() + weightOffsets[layer]; }
+        float* biases(size_t layer) { return data.data() + biasOffsets[layer]; }
+        void zero() { std::fill(data.begin(), data.end(), 0.0f); }
+    };
+
+    // Gradients only exist for dense layers for now
+    inline bool supportsGradients(const NeuralNetwork& net) {
+        for (auto& layer : net.layers) {
+            if (!std::holds_alternative<Layer>(layer)) return false;
+        }
+        return !net.layers.empty();
+    }
+
+    // Per-thread working memory for accumulateGradients (activations + deltas)
+    struct GradientScratch {
+        std::vector<std::vector<float>> activations; // [L + 1]
+        std::vector<std::vector<float>> deltas;      // [L + 1]
+
+        explicit GradientScratch(const NeuralNetwork& net) {
+            const Layer& first = std::get<Layer>(net.layers.front());
+            activations.emplace_back(first.numNodesIn);
+            deltas.emplace_back(first.numNodesIn);
+            for (auto& layer : net.layers) {
+                const Layer& l = std::get<Layer>(layer);
+                activations.emplace_back(l.numNodesOut);
+                deltas.emplace_back(l.numNodesOut);
+            }
+        }
+    };
+
+    // Forward + backward for ONE sample, adding its gradients into `grads` WITHOUT touching
+    // the weights (unlike Layer::backPropagate). Same MSE loss as NeuralNetwork::train.
+    // Returns the sample loss 0.5 * sum((y - t)^2).
+    inline float accumulateGradients(const NeuralNetwork& net, const float* input, const float* target,
+                                     GradientBuffer& grads, GradientScratch& scratch) {
+        const size_t L = net.layers.size();
+        auto& act = scratch.activations;
+        auto& delta = scratch.deltas;
+
+        // 1. Forward Pass
+        std::copy(input, input + act[0].size(), act[0].begin());
+        for (size_t i = 0; i < L; i++) {
+            const Layer& l = std::get<Layer>(net.layers[i]);
+            Kernels::denseForward(act[i].data(), l.weights.data(), l.biases.data(), act[i + 1].data(),
+                                  l.numNodesIn, l.numNodesOut, l.actType);
+        }
+
+        // 2. Loss Gradient
+        float loss = 0.0f;
+        for (size_t o = 0; o < act[L].size(); o++) {
+            float d = act[L][o] - target[o];
+            delta[L][o] = d;
+            loss += 0.5f * d * d;
+        }
+
+        // 3. Backward Pass (Loop reversed)
+        for (size_t i = L; i-- > 0;) {
+            const Layer& l = std::get<Layer>(net.layers[i]);
+            Kernels::activationDelta(delta[i + 1].data(), act[i + 1].data(), delta[i + 1].data(), l.numNodesOut, l.actType);
+            Kernels::denseParamGradients(act[i].data(), delta[i + 1].data(), grads.weights(i), grads.biases(i),
+                                         l.numNodesIn, l.numNodesOut);
+            if (i > 0) {
+                std::fill(delta[i].begin(), delta[i].end(), 0.0f);
+                Kernels::denseInputGradients(delta[i + 1].data(), l.weights.data(), delta[i].data(), l.numNodesIn, l.numNodesOut);
+            }
+        }
+        return loss;
+    }
+
+    // W -= scale * g for every dense layer (scale = learningRate / batchSize for a mean)
+    inline void applyGradients(NeuralNetwork& net, const float* grads, float scale) {
+        size_t offset = 0;
+        for (auto& layer : net.layers) {
+            Layer& l = std::get<Layer>(layer);
+            for (auto& w : l.weights) w -= scale * grads[offset++];
+            for (auto& b : l.biases) b -= scale * grads[offset++];
+        }
+    }
+}
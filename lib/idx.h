@@ -0,0 +1,236 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+
+#include "mapped_file.h"
+
+namespace NN {
+
+    // IDX, the MNIST container: a 4-byte magic [0, 0, type, rank], `rank` big-endian uint32
+    // dimensions, then the elements big-endian and row-major. Dimension 0 counts records
+    // (images, labels, rows of an exported tensor), the rest give the shape of one record.
+    enum class IdxType : uint8_t {
+        U8 = 0x08,
+        I8 = 0x09,
+        I16 = 0x0B,
+        I32 = 0x0C,
+        F32 = 0x0D,
+        F64 = 0x0E,
+    };
+
+    inline size_t idxElementSize(IdxType type) {
+        switch (type) {
+            case IdxType::U8:
+            case IdxType::I8:  return 1;
+            case IdxType::I16: return 2;
+            case IdxType::I32:
+            case IdxType::F32: return 4;
+            case IdxType::F64: return 8;
+        }
+        return 0;
+    }
+
+    struct IdxHeader {
+        IdxType type = IdxType::U8;
+        std::vector<uint32_t> dims;
+
+        size_t rank() const { return dims.size(); }
+        uint64_t records() const { return dims.empty() ? 0 : dims[0]; }
+        size_t elementSize() const { return idxElementSize(type); }
+        size_t dataOffset() const { return 4 + 4 * dims.size(); }
+
+        // Elements per record (1 for a rank-1 file such as labels)
+        uint64_t recordElements() const {
+            uint64_t n = 1;
+            for (size_t d = 1; d < dims.size(); d++) n *= dims[d];
+            return n;
+        }
+        uint64_t recordBytes() const { return recordElements() * elementSize(); }
+
+        // records * recordBytes, false if a product on the way overflows. parse() rejects such
+        // headers, so recordElements()/recordBytes() of a parsed header cannot wrap either.
+        bool dataBytes(uint64_t& bytes) const {
+            bytes = elementSize();
+            for (size_t d = dims.size(); d-- > 0;) {
+                if (__builtin_mul_overflow(bytes, uint64_t(dims[d]), &bytes)) return false;
+            }
+            return true;
+        }
+
+        // "60000x28x28"
+        std::string shape() const {
+            std::string s;
+            for (size_t d = 0; d < dims.size(); d++) s += (d ? "x" : "") + std::to_string(dims[d]);
+            return s;
+        }
+
+        // Parses and validates a header from `bytes` (at least `size` available); a shape whose
+        // byte size does not fit 64 bits is rejected
+        bool parse(const unsigned char* bytes, size_t size) {
+            if (size < 4 || bytes[0] != 0 || bytes[1] != 0) return false;
+            type = static_cast<IdxType>(bytes[2]);
+            const size_t r = bytes[3];
+            if (idxElementSize(type) == 0 || r == 0 || size < 4 + 4 * r) return false;
+            dims.resize(r);
+            for (size_t d = 0; d < r; d++) dims[d] = loadBigEndian<uint32_t>(bytes + 4 + 4 * d);
+            uint64_t total;
+            return dataBytes(total);
+        }
+
+        template <class U>
+        static U loadBigEndian(const unsigned char* p) {
+            U v = 0;
+            for (size_t i = 0; i < sizeof(U); i++) v = static_cast<U>((v << 8) | p[i]);
+            return v;
+        }
+    };
+
+    // Decodes `count` big-endian elements of `type` into any arithmetic T.
+    // One loop per element type, so each one is a simple (vectorisable) conversion.
+    template <class T>
+    void convertIdxElements(IdxType type, const unsigned char* src, size_t count, T* out) {
+        switch (type) {
+            case IdxType::U8:
+                for (size_t i = 0; i < count; i++) out[i] = static_cast<T>(src[i]);
+                break;
+            case IdxType::I8:
+                for (size_t i = 0; i < count; i++) out[i] = static_cast<T>(static_cast<int8_t>(src[i]));
+                break;
+            case IdxType::I16:
+                for (size_t i = 0; i < count; i++) {
+                    out[i] = static_cast<T>(static_cast<int16_t>(IdxHeader::loadBigEndian<uint16_t>(src + 2 * i)));
+                }
+                break;
+            case IdxType::I32:
+                for (size_t i = 0; i < count; i++) {
+                    out[i] = static_cast<T>(static_cast<int32_t>(IdxHeader::loadBigEndian<uint32_t>(src + 4 * i)));
+                }
+                break;
+            case IdxType::F32:
+                for (size_t i = 0; i < count; i++) {
+                    uint32_t bits = IdxHeader::loadBigEndian<uint32_t>(src + 4 * i);
+                    float f;
+                    std::memcpy(&f, &bits, 4);
+                    out[i] = static_cast<T>(f);
+                }
+                break;
+            case IdxType::F64:
+                for (size_t i = 0; i < count; i++) {
+                    uint64_t bits = IdxHeader::loadBigEndian<uint64_t>(src + 8 * i);
+                    double d;
+                    std::memcpy(&d, &bits, 8);
+                    out[i] = static_cast<T>(d);
+                }
+                break;
+        }
+    }
+
+    // MMAP MODE: the whole file mapped read-only; records are decoded straight out of the page
+    // cache, in any order and from any number of threads.
+    class IdxFile {
+    public:
+        bool open(const std::string& path) {
+            if (!file.open(path)) return false;
+            auto* bytes = reinterpret_cast<const unsigned char*>(file.data());
+            if (!head.parse(bytes, file.size())) {
+                std::cerr << "Error: " << path << " is not a valid IDX file." << std::endl;
+                file.close();
+                return false;
+            }
+            uint64_t dataSize = 0;
+            head.dataBytes(dataSize);
+            if (file.size() - head.dataOffset() < dataSize) {
+                std::cerr << "Error: " << path << " is truncated (" << head.shape() << ")." << std::endl;
+                file.close();
+                return false;
+            }
+            return true;
+        }
+
+        bool isOpen() const { return file.isOpen(); }
+        const IdxHeader& header() const { return head; }
+        uint64_t records() const { return head.records(); }
+
+        // Big-endian bytes of record i
+        const unsigned char* raw(uint64_t i) const {
+            return reinterpret_cast<const unsigned char*>(file.data()) + head.dataOffset() + i * head.recordBytes();
+        }
+
+        // Records [first, first + count) as T, [count][recordElements]
+        template <class T>
+        void read(uint64_t first, uint64_t count, T* out) const {
+            convertIdxElements(head.type, raw(first), count * head.recordElements(), out);
+        }
+
+    private:
+        MappedFile file;
+        IdxHeader head;
+    };
+
+    // STREAMING MODE: reads records front to back through a fixed buffer, for files that
+    // should not be mapped whole (bigger than the address space budget, pipes, ...)
+    class IdxStream {
+    public:
+        explicit IdxStream(size_t bufferBytes = 1 << 20) : bufferSize(bufferBytes) {}
+
+        bool open(const std::string& path) {
+            in.close();
+            in.clear();
+            in.open(path, std::ios::binary);
+            if (!in.is_open()) {
+                std::cerr << "Error: Could not open " << path << std::endl;
+                return false;
+            }
+            unsigned char bytes[4 + 4 * 255];
+            in.read(reinterpret_cast<char*>(bytes), 4);
+            const size_t r = in ? bytes[3] : 0;
+            in.read(reinterpret_cast<char*>(bytes + 4), 4 * r);
+            if (!in || !head.parse(bytes, 4 + 4 * r)) {
+                std::cerr << "Error: " << path << " is not a valid IDX file." << std::endl;
+                in.close();
+                return false;
+            }
+            position = 0;
+            return true;
+        }
+
+        const IdxHeader& header() const { return head; }
+        uint64_t remaining() const { return head.records() - position; }
+
+        // Up to `count` next records as T; returns how many were read (0 at the end or on a
+        // truncated file)
+        template <class T>
+        uint64_t read(uint64_t count, T* out) {
+            count = std::min(count, remaining());
+            const uint64_t recordBytes = head.recordBytes();
+            const uint64_t perChunk = std::max<uint64_t>(1, bufferSize / std::max<uint64_t>(1, recordBytes));
+            uint64_t done = 0;
+            while (done < count) {
+                const uint64_t n = std::min(perChunk, count - done);
+                buffer.resize(n * recordBytes);
+                in.read(reinterpret_cast<char*>(buffer.data()), buffer.size());
+                if (!in) {
+                    std::cerr << "Error: IDX file is truncated." << std::endl;
+                    break;
+                }
+                convertIdxElements(head.type, buffer.data(), n * head.recordElements(), out + done * head.recordElements());
+                done += n;
+            }
+            position += done;
+            return done;
+        }
+
+    private:
+        size_t bufferSize;
+        std::ifstream in;
+        IdxHeader head;
+        uint64_t position = 0;
+        std::vector<unsigned char> buffer;
+    };
+}
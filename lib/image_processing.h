@@ -4,7 +4,17 @@
 #include <string>
 #include <fstream>
 #include <iostream>
+#include <algorithm>
 #include <cstdint> // for uint32_t
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "thread_pool.h"
+#include "idx.h"
 
 namespace ImgProc {
 
@@ -16,94 +26,62 @@ namespace ImgProc {
     };
 
     class MnistLoader {
-    private:
-        // MNIST files use Big-Endian integers. Most PCs are Little-Endian.
-        // We must swap the bytes to read the integers correctly.
-        static uint32_t swapEndian(uint32_t val) {
-            return ((val << 24) & 0xFF000000) |
-                   ((val << 8)  & 0x00FF0000) |
-                   ((val >> 8)  & 0x0000FF00) |
-                   ((val >> 24) & 0x000000FF);
-        }
-
     public:
+        // Any IDX image/label pair through the generic reader (NN::IdxFile): MNIST, EMNIST,
+        // Fashion-MNIST or exported tensors, of any element type and record shape.
+        // u8 pixels are scaled 0-255 -> 0.0-1.0, other types are taken as they are.
+        // Targets are one-hot over max(10, largest label + 1) classes.
         static std::vector<Image> load(const std::string& imagePath, const std::string& labelPath) {
             std::vector<Image> dataset;
 
-            std::ifstream imgFile(imagePath, std::ios::binary);
-            std::ifstream lblFile(labelPath, std::ios::binary);
-
-            if (!imgFile.is_open() || !lblFile.is_open()) {
+            NN::IdxFile imgFile, lblFile;
+            if (!imgFile.open(imagePath) || !lblFile.open(labelPath)) {
                 std::cerr << "Error: Could not open MNIST files." << std::endl;
                 std::cerr << "Checked paths: " << imagePath << " & " << labelPath << std::endl;
                 return dataset;
             }
+            const NN::IdxHeader& images = imgFile.header();
+            const NN::IdxHeader& labels = lblFile.header();
 
-            // 1. READ HEADERS
-            uint32_t magicImg, numImg, rows, cols;
-            uint32_t magicLbl, numLbl;
-
-            imgFile.read(reinterpret_cast<char*>(&magicImg), 4);
-            imgFile.read(reinterpret_cast<char*>(&numImg), 4);
-            imgFile.read(reinterpret_cast<char*>(&rows), 4);
-            imgFile.read(reinterpret_cast<char*>(&cols), 4);
-
-            lblFile.read(reinterpret_cast<char*>(&magicLbl), 4);
-            lblFile.read(reinterpret_cast<char*>(&numLbl), 4);
-
-            // Convert Endianness
-            magicImg = swapEndian(magicImg);
-            numImg   = swapEndian(numImg);
-            rows     = swapEndian(rows);
-            cols     = swapEndian(cols);
-            magicLbl = swapEndian(magicLbl);
-            numLbl   = swapEndian(numLbl);
-
-            // 2. SANITY CHECKS
-            // Magic numbers: 2051 for images, 2049 for labels
-            if (magicImg != 2051 || magicLbl != 2049) {
-                std::cerr << "Error: Invalid MNIST magic numbers!" << std::endl;
+            // SANITY CHECKS: one integer label per record
+            if (labels.rank() != 1 || labels.type == NN::IdxType::F32 || labels.type == NN::IdxType::F64) {
+                std::cerr << "Error: " << labelPath << " is not a label file (" << labels.shape() << ")" << std::endl;
                 return dataset;
             }
-            if (numImg != numLbl) {
+            if (images.records() != labels.records()) {
                 std::cerr << "Error: Image count doesn't match label count!" << std::endl;
                 return dataset;
             }
 
-            std::cout << "Loading " << numImg << " images (" << rows << "x" << cols << ")..." << std::endl;
+            std::cout << "Loading " << images.shape() << " images..." << std::endl;
 
-            // 3. READ DATA
-            int imageSize = rows * cols; // 28 * 28 = 784
-            dataset.resize(numImg);
+            const size_t count = images.records();
+            const size_t imageSize = images.recordElements();
+            std::vector<int> labelValues(count);
+            lblFile.read(0, count, labelValues.data());
+            int classes = 10;
+            for (int l : labelValues) classes = std::max(classes, l + 1);
+            const bool normalize = (images.type == NN::IdxType::U8);
 
-            // Buffers to hold raw bytes
-            // Note: Reading byte-by-byte is slow, better to read chunks or map memory,
-            // but this is simple and sufficient for 60k images.
-            for (uint32_t i = 0; i < numImg; i++) {
-                Image& img = dataset[i];
-                img.pixels.reserve(imageSize);
+            // Decode straight out of the mapping in parallel on the shared pool
+            dataset.resize(count);
+            NN::ThreadPool::instance().parallelFor(0, count, 1024, [&](size_t lo, size_t hi) {
+                for (size_t i = lo; i < hi; i++) {
+                    Image& img = dataset[i];
+                    img.label = labelValues[i];
 
-                // Read Label (1 byte)
-                unsigned char labelByte;
-                lblFile.read(reinterpret_cast<char*>(&labelByte), 1);
-                img.label = static_cast<int>(labelByte);
+                    // Create Target Vector (One-Hot)
+                    img.target.assign(classes, 0.0f);
+                    if (img.label >= 0) img.target[img.label] = 1.0f;
 
-                // Create Target Vector (One-Hot)
-                img.target.assign(10, 0.0f);
-                if (img.label >= 0 && img.label < 10) {
-                    img.target[img.label] = 1.0f;
-                }
-
-                // Read Pixels (784 bytes)
-                // We read into a temporary buffer to minimize file I/O calls
-                std::vector<unsigned char> pixelBuffer(imageSize);
-                imgFile.read(reinterpret_cast<char*>(pixelBuffer.data()), imageSize);
-
-                for (int j = 0; j < imageSize; j++) {
+                    img.pixels.resize(imageSize);
+                    imgFile.read(i, 1, img.pixels.data());
                     // Normalize 0-255 -> 0.0-1.0
-                    img.pixels.push_back(static_cast<float>(pixelBuffer[j]) / 255.0f);
+                    if (normalize) {
+                        for (float& p : img.pixels) p /= 255.0f;
+                    }
                 }
-            }
+            });
 
             std::cout << "Done. Loaded " << dataset.size() << " samples." << std::endl;
             return dataset;
@@ -171,5 +149,110 @@ namespace ImgProc {
 
             return out;
         }
+
+        // --- uint8 counterparts -------------------------------------------------------------
+        // Same transforms on 0-255 images (PackedDataset, raw IDX records), so augmentation can
+        // stay in the compact domain and read/write a quarter of the bytes. They write into a
+        // caller-provided buffer (no allocation per sample). src and dst must not overlap.
+
+        // Every output row is one shifted copy of a source row plus zero fill
+        static void translateImageU8(const uint8_t* src, uint8_t* dst, int dx, int dy, int width = 28, int height = 28) {
+            for (int y = 0; y < height; ++y) {
+                uint8_t* outRow = dst + y * width;
+                const int sy = y - dy;
+                if (sy < 0 || sy >= height || dx >= width || -dx >= width) {
+                    std::memset(outRow, 0, width);
+                    continue;
+                }
+                const uint8_t* srcRow = src + sy * width;
+                if (dx >= 0) {
+                    std::memset(outRow, 0, dx);
+                    std::memcpy(outRow + dx, srcRow, width - dx);
+                } else {
+                    std::memcpy(outRow, srcRow - dx, width + dx);
+                    std::memset(outRow + width + dx, 0, -dx);
+                }
+            }
+        }
+
+        // Bilinear scale about the center in FIXED POINT: the sampling grid is computed as in
+        // scaleImage, but the weights are 8-bit integers (0..256), so every pixel is integer
+        // multiply-adds. It runs separably: each output row first blends its two source rows
+        // (16 pixels per SSE2 instruction, 16-bit lanes), then blends horizontally out of
+        // that blended row. Results are within 1 of round(255 * scaleImage).
+        static void scaleImageU8(const uint8_t* src, uint8_t* dst, float scale, int srcW = 28, int srcH = 28, int dstW = 28, int dstH = 28) {
+            constexpr int bits = 8;
+            constexpr int one = 1 << bits;
+
+            const float cx_src = (srcW - 1) / 2.0f;
+            const float cy_src = (srcH - 1) / 2.0f;
+            const float cx_dst = (dstW - 1) / 2.0f;
+            const float cy_dst = (dstH - 1) / 2.0f;
+
+            // 1. Per-column source index and weight (-1 = outside the source)
+            int colIndex[256];
+            int colWeight[256];
+            if (dstW > 256 || srcW > 1024) {
+                std::cerr << "Error: scaleImageU8 supports up to 256 output / 1024 source columns." << std::endl;
+                return;
+            }
+            for (int x = 0; x < dstW; ++x) {
+                float sx = (x - cx_dst) / scale + cx_src;
+                if (sx < 0 || sx >= srcW - 1) {
+                    colIndex[x] = -1;
+                    continue;
+                }
+                int x0 = static_cast<int>(std::floor(sx));
+                colIndex[x] = x0;
+                colWeight[x] = static_cast<int>(std::lround((sx - x0) * one));
+            }
+
+            uint16_t blended[1024]; // one vertically blended source row, scaled by 256
+            for (int y = 0; y < dstH; ++y) {
+                uint8_t* outRow = dst + y * dstW;
+                float sy = (y - cy_dst) / scale + cy_src;
+                if (sy < 0 || sy >= srcH - 1) {
+                    std::memset(outRow, 0, dstW);
+                    continue;
+                }
+                int y0 = static_cast<int>(std::floor(sy));
+                const int wy = static_cast<int>(std::lround((sy - y0) * one));
+                const uint8_t* row0 = src + y0 * srcW;
+                const uint8_t* row1 = row0 + srcW;
+
+                // 2. Vertical: blended = row0 * (256 - wy) + row1 * wy  (<= 255 * 256, fits 16 bits)
+                int c = 0;
+#if defined(__SSE2__)
+                const __m128i zero = _mm_setzero_si128();
+                const __m128i w0 = _mm_set1_epi16(static_cast<short>(one - wy));
+                const __m128i w1 = _mm_set1_epi16(static_cast<short>(wy));
+                for (; c + 16 <= srcW; c += 16) {
+                    __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + c));
+                    __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + c));
+                    __m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(a, zero), w0),
+                                               _mm_mullo_epi16(_mm_unpacklo_epi8(b, zero), w1));
+                    __m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(a, zero), w0),
+                                               _mm_mullo_epi16(_mm_unpackhi_epi8(b, zero), w1));
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(blended + c), lo);
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(blended + c + 8), hi);
+                }
+#endif
+                for (; c < srcW; ++c) {
+                    blended[c] = static_cast<uint16_t>(row0[c] * (one - wy) + row1[c] * wy);
+                }
+
+                // 3. Horizontal, then round away the two 8-bit scales
+                for (int x = 0; x < dstW; ++x) {
+                    const int x0 = colIndex[x];
+                    if (x0 < 0) {
+                        outRow[x] = 0;
+                        continue;
+                    }
+                    const int wx = colWeight[x];
+                    const int v = blended[x0] * (one - wx) + blended[x0 + 1] * wx;
+                    outRow[x] = static_cast<uint8_t>((v + (1 << (2 * bits - 1))) >> (2 * bits));
+                }
+            }
+        }
     };
 }
@@ -0,0 +1,164 @@
+#pragma once
+
+#include "activation.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+
+namespace NN {
+
+    // Raw dense-layer kernels shared by Layer and the autodiff Tape.
+    // Weights are stored [in][out] (row = input neuron), so every inner loop below
+    // walks one contiguous row of W and the compiler can vectorise it.
+    namespace Kernels {
+
+        // out = b + in * W (b may be nullptr)
+        inline void linearForward(const float* in, const float* W, const float* b, float* out, int nIn, int nOut) {
+            for (int o = 0; o < nOut; o++) out[o] = b ? b[o] : 0.0f;
+            for (int i = 0; i < nIn; i++) {
+                const float x = in[i];
+                if (x == 0.0f) continue; // MNIST is mostly black pixels
+                const float* row = &W[i * nOut];
+                for (int o = 0; o < nOut; o++) out[o] += x * row[o];
+            }
+        }
+
+        // out = f(b + in * W)
+        inline void denseForward(const float* in, const float* W, const float* b, float* out,
+                                 int nIn, int nOut, ActivationType act) {
+            linearForward(in, W, b, out, nIn, nOut);
+            for (int o = 0; o < nOut; o++) out[o] = activate(act, out[o]);
+        }
+
+        // delta = dC/dy * f'(y), with y the ACTIVATED outputs
+        inline void activationDelta(const float* outGrad, const float* y, float* delta, int n, ActivationType act) {
+            for (int o = 0; o < n; o++) delta[o] = outGrad[o] * activateDerivative(act, y[o]);
+        }
+
+        // inGrad += W * delta (Chain Rule: dC/dInput = dC/dOutput * dOutput/dInput)
+        inline void denseInputGradients(const float* delta, const float* W, float* inGrad, int nIn, int nOut) {
+            for (int i = 0; i < nIn; i++) {
+                const float* row = &W[i * nOut];
+                float sum = 0.0f;
+                for (int o = 0; o < nOut; o++) sum += delta[o] * row[o];
+                inGrad[i] += sum;
+            }
+        }
+
+        // dW += in (outer) delta, db += delta (db may be nullptr)
+        inline void denseParamGradients(const float* in, const float* delta, float* dW, float* db, int nIn, int nOut) {
+            if (db) {
+                for (int o = 0; o < nOut; o++) db[o] += delta[o];
+            }
+            for (int i = 0; i < nIn; i++) {
+                const float x = in[i];
+                if (x == 0.0f) continue;
+                float* row = &dW[i * nOut];
+                for (int o = 0; o < nOut; o++) row[o] += x * delta[o];
+            }
+        }
+
+        // Fused SGD step: W -= lr * (in (outer) delta + l1 * sign(W)), b -= lr * delta (b may be nullptr)
+        inline void denseSgdUpdate(const float* in, const float* delta, float* W, float* b,
+                                   int nIn, int nOut, float learningRate, float l1) {
+            if (b) {
+                for (int o = 0; o < nOut; o++) b[o] -= learningRate * delta[o];
+            }
+            for (int i = 0; i < nIn; i++) {
+                const float x = in[i];
+                float* row = &W[i * nOut];
+                if (l1 == 0.0f) {
+                    if (x == 0.0f) continue;
+                    for (int o = 0; o < nOut; o++) row[o] -= learningRate * x * delta[o];
+                } else {
+                    for (int o = 0; o < nOut; o++) {
+                        float w = row[o];
+                        float l1term = (w > 0.0f) ? 1.0f : (w < 0.0f ? -1.0f : 0.0f);
+                        row[o] -= learningRate * (x * delta[o] + l1 * l1term);
+                    }
+                }
+            }
+        }
+
+        // --- PARALLEL VERSIONS (shared ThreadPool) ---
+        // Wide layers are cut into tiles; small ones (like the default 784x64) stay on the
+        // calling thread, where the fork/join would cost more than it saves.
+        constexpr long parallelThreshold = 1 << 16; // multiply-adds per call
+
+        inline bool worthSplitting(long work) {
+            return work >= parallelThreshold && ThreadPool::instance().size() > 1;
+        }
+
+        // Rows of W per task, so each task gets roughly 16K multiply-adds
+        inline size_t rowGrain(int nOut) {
+            return static_cast<size_t>(std::max(1, (1 << 14) / std::max(1, nOut)));
+        }
+
+        // Tiles of OUTPUT columns: each task owns out[lo, hi) and only reads W[:, lo:hi)
+        inline void parallelDenseForward(const float* in, const float* W, const float* b, float* out,
+                                         int nIn, int nOut, ActivationType act) {
+            if (!worthSplitting(static_cast<long>(nIn) * nOut)) {
+                denseForward(in, W, b, out, nIn, nOut, act);
+                return;
+            }
+            ThreadPool::instance().parallelFor(0, nOut, 64, [&](size_t lo, size_t hi) {
+                for (size_t o = lo; o < hi; o++) out[o] = b ? b[o] : 0.0f;
+                for (int i = 0; i < nIn; i++) {
+                    const float x = in[i];
+                    if (x == 0.0f) continue;
+                    const float* row = &W[static_cast<size_t>(i) * nOut];
+                    for (size_t o = lo; o < hi; o++) out[o] += x * row[o];
+                }
+                for (size_t o = lo; o < hi; o++) out[o] = activate(act, out[o]);
+            });
+        }
+
+        inline void parallelActivationDelta(const float* outGrad, const float* y, float* delta, int n, ActivationType act) {
+            if (!worthSplitting(n)) {
+                activationDelta(outGrad, y, delta, n, act);
+                return;
+            }
+            ThreadPool::instance().parallelFor(0, n, 4096, [&](size_t lo, size_t hi) {
+                activationDelta(outGrad + lo, y + lo, delta + lo, static_cast<int>(hi - lo), act);
+            });
+        }
+
+        // Tiles of INPUT rows for the three backward kernels: rows never overlap, so no locking
+        inline void parallelDenseInputGradients(const float* delta, const float* W, float* inGrad, int nIn, int nOut) {
+            if (!worthSplitting(static_cast<long>(nIn) * nOut)) {
+                denseInputGradients(delta, W, inGrad, nIn, nOut);
+                return;
+            }
+            ThreadPool::instance().parallelFor(0, nIn, rowGrain(nOut), [&](size_t lo, size_t hi) {
+                denseInputGradients(delta, W + lo * nOut, inGrad + lo, static_cast<int>(hi - lo), nOut);
+            });
+        }
+
+        inline void parallelDenseParamGradients(const float* in, const float* delta, float* dW, float* db, int nIn, int nOut) {
+            if (!worthSplitting(static_cast<long>(nIn) * nOut)) {
+                denseParamGradients(in, delta, dW, db, nIn, nOut);
+                return;
+            }
+            if (db) {
+                for (int o = 0; o < nOut; o++) db[o] += delta[o];
+            }
+            ThreadPool::instance().parallelFor(0, nIn, rowGrain(nOut), [&](size_t lo, size_t hi) {
+                denseParamGradients(in + lo, delta, dW + lo * nOut, nullptr, static_cast<int>(hi - lo), nOut);
+            });
+        }
+
+        inline void parallelDenseSgdUpdate(const float* in, const float* delta, float* W, float* b,
+                                           int nIn, int nOut, float learningRate, float l1) {
+            if (!worthSplitting(static_cast<long>(nIn) * nOut)) {
+                denseSgdUpdate(in, delta, W, b, nIn, nOut, learningRate, l1);
+                return;
+            }
+            if (b) {
+                for (int o = 0; o < nOut; o++) b[o] -= learningRate * delta[o];
+            }
+            ThreadPool::instance().parallelFor(0, nIn, rowGrain(nOut), [&](size_t lo, size_t hi) {
+                denseSgdUpdate(in + lo, delta, W + lo * nOut, nullptr, static_cast<int>(hi - lo), nOut, learningRate, l1);
+            });
+        }
+    }
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <string>
+#include <streambuf>
+#include <iostream>
+#include <cstring>
+#include <cerrno>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace NN {
+
+    // Read-only mmap of a whole file. The pages come straight from the page cache: no
+    // read() copies, and a file that is already cached "loads" without touching the disk.
+    class MappedFile {
+    public:
+        MappedFile() = default;
+
+        explicit MappedFile(const std::string& path) { open(path); }
+
+        ~MappedFile() { close(); }
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        bool open(const std::string& path) {
+            close();
+            int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd < 0) {
+                std::cerr << "Error: Could not open " << path << ": " << std::strerror(errno) << std::endl;
+                return false;
+            }
+            struct stat st{};
+            if (::fstat(fd, &st) < 0 || st.st_size == 0) {
+                ::close(fd);
+                return false;
+            }
+            void* p = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+            ::close(fd); // the mapping keeps the file alive
+            if (p == MAP_FAILED) {
+                std::cerr << "Error: Could not map " << path << ": " << std::strerror(errno) << std::endl;
+                return false;
+            }
+            base = static_cast<const char*>(p);
+            length = st.st_size;
+            return true;
+        }
+
+        void close() {
+            if (base) ::munmap(const_cast<char*>(base), length);
+            base = nullptr;
+            length = 0;
+        }
+
+        bool isOpen() const { return base != nullptr; }
+        const char* data() const { return base; }
+        size_t size() const { return length; }
+
+    private:
+        const char* base = nullptr;
+        size_t length = 0;
+    };
+
+    // std::istream over a memory range, so the existing read(std::istream&) code can parse
+    // a mapped file directly (every read() is one memcpy out of the mapping)
+    class MemoryStreamBuf : public std::streambuf {
+    public:
+        MemoryStreamBuf(const char* data, size_t size) {
+            char* p = const_cast<char*>(data);
+            setg(p, p, p + size);
+        }
+
+    protected:
+        // Read-side seeking only, so tellg()/seekg() work the same as on an ifstream
+        pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override {
+            if (!(which & std::ios_base::in)) return pos_type(off_type(-1));
+            char* from = dir == std::ios_base::beg ? eback() : dir == std::ios_base::cur ? gptr() : egptr();
+            const off_type target = (from - eback()) + off;
+            if (target < 0 || target > egptr() - eback()) return pos_type(off_type(-1));
+            setg(eback(), eback() + target, egptr());
+            return pos_type(target);
+        }
+
+        pos_type seekpos(pos_type pos, std::ios_base::openmode which) override {
+            return seekoff(off_type(pos), std::ios_base::beg, which);
+        }
+    };
+
+    // Bytes between the read position and the end, or -1 if the stream cannot seek. Readers
+    // check sizes from a file header against this before allocating for them.
+    inline std::streamoff streamBytesLeft(std::istream& file) {
+        const std::streampos here = file.tellg();
+        if (here == std::streampos(-1)) return -1;
+        file.seekg(0, std::ios_base::end);
+        const std::streampos end = file.tellg();
+        file.seekg(here);
+        if (end == std::streampos(-1) || !file) {
+            file.clear();
+            return -1;
+        }
+        return end - here;
+    }
+}
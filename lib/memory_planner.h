@@ -0,0 +1,235 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <iostream>
+#include <variant>
+
+#include "network.h"
+#include "kernels.h"
+#include "thread_pool.h"
+
+namespace NN {
+
+    // Static memory planner. Every buffer says how big it is and in which steps of the
+    // schedule it is alive ([firstUse, lastUse], inclusive). solve() packs them into one
+    // flat allocation: two buffers may share bytes only if their lifetimes do not overlap.
+    //
+    // Greedy "biggest first, lowest free offset" packing. Not optimal, but for the
+    // chain-shaped graphs we have it lands on (or very near) the liveness lower bound.
+    class MemoryPlan {
+    public:
+        struct Buffer {
+            std::string name;
+            size_t size;
+            int firstUse;
+            int lastUse;
+            size_t offset = 0;
+        };
+
+        std::vector<Buffer> buffers;
+        size_t totalSize = 0;
+
+        int add(const std::string& name, size_t size, int firstUse, int lastUse) {
+            buffers.push_back({name, size, firstUse, lastUse});
+            return static_cast<int>(buffers.size()) - 1;
+        }
+
+        void solve() {
+            std::vector<int> order(buffers.size());
+            for (size_t i = 0; i < order.size(); i++) order[i] = static_cast<int>(i);
+            std::sort(order.begin(), order.end(), [&](int a, int b) {
+                return buffers[a].size > buffers[b].size;
+            });
+
+            std::vector<int> placed;
+            totalSize = 0;
+            for (int id : order) {
+                Buffer& buf = buffers[id];
+
+                // 1. Collect the byte ranges of placed buffers that are alive at the same time
+                std::vector<std::pair<size_t, size_t>> taken;
+                for (int other : placed) {
+                    const Buffer& o = buffers[other];
+                    bool overlaps = buf.firstUse <= o.lastUse && o.firstUse <= buf.lastUse;
+                    if (overlaps) taken.push_back({o.offset, o.offset + o.size});
+                }
+                std::sort(taken.begin(), taken.end());
+
+                // 2. First gap that fits
+                size_t offset = 0;
+                for (auto& range : taken) {
+                    if (offset + buf.size <= range.first) break;
+                    offset = std::max(offset, range.second);
+                }
+                buf.offset = offset;
+                totalSize = std::max(totalSize, offset + buf.size);
+                placed.push_back(id);
+            }
+        }
+
+        // What we would need with one private allocation per buffer
+        size_t naiveSize() const {
+            size_t total = 0;
+            for (auto& b : buffers) total += b.size;
+            return total;
+        }
+
+        void print() const {
+            std::cout << "Memory plan: " << buffers.size() << " buffers, "
+                      << totalSize * sizeof(float) / 1024 << " KB planned vs "
+                      << naiveSize() * sizeof(float) / 1024 << " KB naive" << std::endl;
+        }
+    };
+
+    // Mini-batch trainer for dense networks that keeps EVERY activation and gradient in one
+    // planned buffer, instead of Layer::lastInputs/lastOutputs plus the returned copies.
+    //
+    // Schedule for L layers (one "step" each):
+    //   0 .. L-1     forward through layer i: act[i] -> act[i+1]
+    //   L            loss gradient: grad[L] = act[L] - target
+    //   2L - i       backward through layer i: grad[i+1] -> delta (in place) -> grad[i], update W
+    class PlannedTrainer {
+    public:
+        NeuralNetwork& net;
+        int batchSize;
+        MemoryPlan plan;
+        std::vector<float> arena;
+        bool valid = true;
+
+        PlannedTrainer(NeuralNetwork& network, int batch) : net(network), batchSize(batch) {
+            const int L = static_cast<int>(net.layers.size());
+            for (auto& layer : net.layers) {
+                if (!std::holds_alternative<Layer>(layer)) {
+                    std::cerr << "Error: PlannedTrainer only supports dense layers." << std::endl;
+                    valid = false;
+                    return;
+                }
+            }
+            if (L == 0) {
+                valid = false;
+                return;
+            }
+
+            // 1. Activations: act[i] is written by layer i-1 and read until layer i-1 has
+            //    gone backwards (it needs its outputs for f'), act[0] until layer 0 did.
+            for (int i = 0; i <= L; i++) {
+                int first = (i == 0) ? 0 : i - 1;
+                int last = (i == 0) ? backwardStep(0) : backwardStep(i - 1);
+                actIds.push_back(plan.add("act" + std::to_string(i), (size_t)width(i) * batchSize, first, last));
+            }
+
+            // 2. Gradients: grad[L] comes from the loss, grad[i] from layer i's backward,
+            //    and each one is consumed by the very next backward step.
+            gradIds.assign(L + 1, -1);
+            gradIds[L] = plan.add("grad" + std::to_string(L), (size_t)width(L) * batchSize, L, backwardStep(L - 1));
+            for (int i = L - 1; i >= 1; i--) {
+                gradIds[i] = plan.add("grad" + std::to_string(i), (size_t)width(i) * batchSize, backwardStep(i), backwardStep(i - 1));
+            }
+
+            plan.solve();
+            arena.assign(plan.totalSize, 0.0f);
+        }
+
+        // Rows are samples. Returns the summed loss 0.5 * (y - t)^2 over the batch.
+        float trainBatch(const std::vector<const float*>& inputs, const std::vector<const float*>& targets,
+                         float learningRate, float l1 = 0.0f) {
+            if (!valid) return 0.0f;
+            const int L = static_cast<int>(net.layers.size());
+            const int B = std::min<int>(batchSize, static_cast<int>(inputs.size()));
+
+            // 1. Load the batch into act[0]
+            float* a0 = act(0);
+            for (int b = 0; b < B; b++) {
+                std::copy(inputs[b], inputs[b] + width(0), a0 + (size_t)b * width(0));
+            }
+
+            // 2. Forward Pass
+            for (int i = 0; i < L; i++) {
+                Layer& layer = dense(i);
+                const float* in = act(i);
+                float* out = act(i + 1);
+                // Samples are independent: one per task (a single sample splits the layer instead)
+                if (B == 1) {
+                    Kernels::parallelDenseForward(in, layer.weights.data(), layer.biases.data(), out,
+                                                  layer.numNodesIn, layer.numNodesOut, layer.actType);
+                    continue;
+                }
+                ThreadPool::instance().parallelFor(0, B, 1, [&](size_t lo, size_t hi) {
+                    for (size_t b = lo; b < hi; b++) {
+                        Kernels::denseForward(in + b * layer.numNodesIn, layer.weights.data(), layer.biases.data(),
+                                              out + b * layer.numNodesOut, layer.numNodesIn, layer.numNodesOut, layer.actType);
+                    }
+                });
+            }
+
+            // 3. Loss Gradient (MSE, same as NeuralNetwork::train)
+            float loss = 0.0f;
+            const float* y = act(L);
+            float* g = grad(L);
+            for (int b = 0; b < B; b++) {
+                for (int o = 0; o < width(L); o++) {
+                    float d = y[(size_t)b * width(L) + o] - targets[b][o];
+                    g[(size_t)b * width(L) + o] = d;
+                    loss += 0.5f * d * d;
+                }
+            }
+
+            // 4. Backward Pass (Loop reversed). The batch gradient is the mean, so every
+            //    sample updates with lr / B; input gradients are taken before any update.
+            const float stepSize = learningRate / B;
+            for (int i = L - 1; i >= 0; i--) {
+                Layer& layer = dense(i);
+                const int nIn = layer.numNodesIn;
+                const int nOut = layer.numNodesOut;
+                float* delta = grad(i + 1);
+                const float* outs = act(i + 1);
+                const float* ins = act(i);
+
+                for (int b = 0; b < B; b++) {
+                    Kernels::activationDelta(delta + (size_t)b * nOut, outs + (size_t)b * nOut, delta + (size_t)b * nOut, nOut, layer.actType);
+                }
+                if (i > 0) {
+                    float* inGrad = grad(i);
+                    std::fill(inGrad, inGrad + (size_t)B * nIn, 0.0f);
+                    ThreadPool::instance().parallelFor(0, B, 1, [&](size_t lo, size_t hi) {
+                        for (size_t b = lo; b < hi; b++) {
+                            Kernels::parallelDenseInputGradients(delta + b * nOut, layer.weights.data(), inGrad + b * nIn, nIn, nOut);
+                        }
+                    });
+                }
+
+                // The update writes W, so split by rows of W (never by sample)
+                for (int b = 0; b < B; b++) {
+                    for (int o = 0; o < nOut; o++) layer.biases[o] -= stepSize * delta[(size_t)b * nOut + o];
+                }
+                ThreadPool::instance().parallelFor(0, nIn, Kernels::rowGrain(nOut), [&](size_t lo, size_t hi) {
+                    for (int b = 0; b < B; b++) {
+                        Kernels::denseSgdUpdate(ins + (size_t)b * nIn + lo, delta + (size_t)b * nOut, layer.weights.data() + lo * nOut,
+                                                nullptr, static_cast<int>(hi - lo), nOut, stepSize, l1);
+                    }
+                });
+            }
+            return loss;
+        }
+
+        // Network outputs of the last trainBatch, row b = sample b
+        const float* outputs() { return act(static_cast<int>(net.layers.size())); }
+
+    private:
+        std::vector<int> actIds;
+        std::vector<int> gradIds;
+
+        int backwardStep(int layer) const { return 2 * static_cast<int>(net.layers.size()) - layer; }
+
+        Layer& dense(int i) { return std::get<Layer>(net.layers[i]); }
+
+        int width(int i) {
+            return (i == 0) ? dense(0).numNodesIn : dense(i - 1).numNodesOut;
+        }
+
+        float* act(int i) { return arena.data() + plan.buffers[actIds[i]].offset; }
+        float* grad(int i) { return arena.data() + plan.buffers[gradIds[i]].offset; }
+    };
+}
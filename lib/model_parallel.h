@@ -0,0 +1,225 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <thread>
+#include <barrier>
+#include <atomic>
+#include <variant>
+#include <algorithm>
+#include <iostream>
+
+#include "network.h"
+#include "kernels.h"
+#include "numa.h"
+
+namespace NN {
+
+    // Model parallelism for VERY wide dense layers (tens of thousands of outputs).
+    //
+    // The output neurons are cut into one contiguous slice per thread. Each pinned thread
+    // owns its slice of the weights as a private [nIn][sliceWidth] matrix that it allocated
+    // itself, so the slice stays in that core's cache from step to step. Per step only the
+    // input vector is broadcast, and only the partial input gradients are exchanged.
+    //
+    // The wrapped Layer's weights are copied into the slices; call writeBack() to copy
+    // them back before saving.
+    class PartitionedLayer {
+    public:
+        Layer& layer;
+        int numThreads;
+
+        PartitionedLayer(Layer& l, int numWorkers)
+        : layer(l), numThreads(std::max(1, std::min(numWorkers, l.numNodesOut))),
+          start(numThreads + 1), done(numThreads + 1), exchange(numThreads), workers(numThreads) {
+            NumaTopology topo = NumaTopology::detect();
+            std::vector<int> cpus;
+            for (auto& node : topo.nodeCpus) cpus.insert(cpus.end(), node.begin(), node.end());
+
+            partials.resize(numThreads);
+            for (int t = 0; t < numThreads; t++) {
+                workers[t].outBegin = layer.numNodesOut * t / numThreads;
+                workers[t].outEnd = layer.numNodesOut * (t + 1) / numThreads;
+                workers[t].inBegin = layer.numNodesIn * t / numThreads;
+                workers[t].inEnd = layer.numNodesIn * (t + 1) / numThreads;
+                workers[t].cpu = cpus[t % cpus.size()];
+            }
+            for (int t = 0; t < numThreads; t++) {
+                threads.emplace_back([this, t] { workerLoop(t); });
+            }
+            run(Command::Load);
+        }
+
+        ~PartitionedLayer() {
+            run(Command::Stop);
+            for (auto& t : threads) t.join();
+        }
+
+        PartitionedLayer(const PartitionedLayer&) = delete;
+        PartitionedLayer& operator=(const PartitionedLayer&) = delete;
+
+        // 1. FORWARD PASS (same contract as Layer::calculateOutput)
+        std::vector<float> calculateOutput(const std::vector<float>& inputs) {
+            layer.lastInputs = inputs;
+            layer.lastOutputs.assign(layer.numNodesOut, 0.0f);
+            run(Command::Forward);
+            return layer.lastOutputs;
+        }
+
+        // 2. BACKWARD PASS (same contract as Layer::backPropagate)
+        std::vector<float> backPropagate(const std::vector<float>& outputGradients, float learningRate, float l1 = 0.0f) {
+            outGrad = &outputGradients;
+            lr = learningRate;
+            l1Strength = l1;
+            inputGradients.assign(layer.numNodesIn, 0.0f);
+            run(Command::Backward);
+            return inputGradients;
+        }
+
+        // Copy the slices back into layer.weights / layer.biases
+        void writeBack() { run(Command::WriteBack); }
+
+    private:
+        enum class Command { Load, Forward, Backward, WriteBack, Stop };
+
+        struct Worker {
+            int outBegin = 0, outEnd = 0; // my output neurons
+            int inBegin = 0, inEnd = 0;   // my share of the input-gradient reduction
+            int cpu = 0;
+            std::vector<float> weights;   // [nIn][outEnd - outBegin]
+            std::vector<float> biases;
+            std::vector<float> delta;
+        };
+
+        std::barrier<> start;    // caller + workers
+        std::barrier<> done;     // caller + workers
+        std::barrier<> exchange; // workers only
+        std::vector<Worker> workers;
+        std::vector<std::thread> threads;
+        std::vector<std::vector<float>> partials; // per-thread dC/dInput from its slice only
+        std::vector<float> inputGradients;
+        Command command = Command::Load;
+
+        const std::vector<float>* outGrad = nullptr;
+        float lr = 0.0f;
+        float l1Strength = 0.0f;
+
+        void run(Command c) {
+            command = c;
+            start.arrive_and_wait();
+            done.arrive_and_wait();
+        }
+
+        void workerLoop(int t) {
+            pinThisThread(workers[t].cpu);
+            Worker& me = workers[t];
+            const int nIn = layer.numNodesIn;
+            const int nOut = layer.numNodesOut;
+            const int width = me.outEnd - me.outBegin;
+
+            while (true) {
+                start.arrive_and_wait();
+                const Command c = command;
+
+                if (c == Command::Load) {
+                    // First touch by the owner: the slice lives in this core's memory/cache
+                    me.weights.resize(static_cast<size_t>(nIn) * width);
+                    for (int i = 0; i < nIn; i++) {
+                        std::copy(&layer.weights[static_cast<size_t>(i) * nOut + me.outBegin],
+                                  &layer.weights[static_cast<size_t>(i) * nOut + me.outEnd],
+                                  &me.weights[static_cast<size_t>(i) * width]);
+                    }
+                    me.biases.assign(layer.biases.begin() + me.outBegin, layer.biases.begin() + me.outEnd);
+                    me.delta.resize(width);
+                    partials[t].assign(nIn, 0.0f);
+                } else if (c == Command::Forward) {
+                    Kernels::denseForward(layer.lastInputs.data(), me.weights.data(), me.biases.data(),
+                                          &layer.lastOutputs[me.outBegin], nIn, width, layer.actType);
+                } else if (c == Command::Backward) {
+                    // 1. My outputs' deltas, my partial input gradients (old weights), my update
+                    Kernels::activationDelta(&(*outGrad)[me.outBegin], &layer.lastOutputs[me.outBegin],
+                                             me.delta.data(), width, layer.actType);
+                    std::fill(partials[t].begin(), partials[t].end(), 0.0f);
+                    Kernels::denseInputGradients(me.delta.data(), me.weights.data(), partials[t].data(), nIn, width);
+                    Kernels::denseSgdUpdate(layer.lastInputs.data(), me.delta.data(), me.weights.data(), me.biases.data(),
+                                            nIn, width, lr, l1Strength);
+                    exchange.arrive_and_wait();
+
+                    // 2. Exchange: sum everyone's partials for my range of inputs
+                    for (int i = me.inBegin; i < me.inEnd; i++) {
+                        float sum = 0.0f;
+                        for (auto& p : partials) sum += p[i];
+                        inputGradients[i] = sum;
+                    }
+                } else if (c == Command::WriteBack) {
+                    for (int i = 0; i < nIn; i++) {
+                        std::copy(&me.weights[static_cast<size_t>(i) * width],
+                                  &me.weights[static_cast<size_t>(i) * width] + width,
+                                  &layer.weights[static_cast<size_t>(i) * nOut + me.outBegin]);
+                    }
+                    std::copy(me.biases.begin(), me.biases.end(), layer.biases.begin() + me.outBegin);
+                } else {
+                    done.arrive_and_wait();
+                    return;
+                }
+
+                done.arrive_and_wait();
+            }
+        }
+    };
+
+    // Runs a whole NeuralNetwork with every dense layer of at least `minOutputs` neurons
+    // partitioned; everything else goes through the normal layer code.
+    class ModelParallelNetwork {
+    public:
+        NeuralNetwork& net;
+        std::vector<std::unique_ptr<PartitionedLayer>> partitioned; // nullptr = not partitioned
+
+        ModelParallelNetwork(NeuralNetwork& network, int numWorkers, int minOutputs = 4096) : net(network) {
+            for (auto& layer : net.layers) {
+                Layer* dense = std::get_if<Layer>(&layer);
+                if (dense && dense->numNodesOut >= minOutputs) {
+                    partitioned.push_back(std::make_unique<PartitionedLayer>(*dense, numWorkers));
+                } else {
+                    partitioned.push_back(nullptr);
+                }
+            }
+        }
+
+        std::vector<float> feedForward(std::vector<float> inputs) {
+            for (size_t i = 0; i < net.layers.size(); i++) {
+                if (partitioned[i]) {
+                    inputs = partitioned[i]->calculateOutput(inputs);
+                } else {
+                    inputs = std::visit([&](auto& l) { return l.calculateOutput(inputs); }, net.layers[i]);
+                }
+            }
+            return inputs;
+        }
+
+        // Same as NeuralNetwork::train
+        void train(const std::vector<float>& inputs, const std::vector<float>& targets, float learningRate, float l1 = 0.0f) {
+            net.setTraining(true);
+            std::vector<float> results = feedForward(inputs);
+
+            std::vector<float> gradients(results.size());
+            for (size_t i = 0; i < results.size(); i++) gradients[i] = results[i] - targets[i];
+
+            for (int i = static_cast<int>(net.layers.size()) - 1; i >= 0; i--) {
+                if (partitioned[i]) {
+                    gradients = partitioned[i]->backPropagate(gradients, learningRate, l1);
+                } else {
+                    gradients = std::visit([&](auto& l) { return l.backPropagate(gradients, learningRate, l1); }, net.layers[i]);
+                }
+            }
+            net.setTraining(false);
+        }
+
+        // Copy every partitioned layer back into `net` (e.g. before net.save)
+        void writeBack() {
+            for (auto& p : partitioned) {
+                if (p) p->writeBack();
+            }
+        }
+    };
+}
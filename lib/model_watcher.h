@@ -0,0 +1,106 @@
+#pragma once
+
+#include <string>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <iostream>
+#include <cstring>
+#include <cerrno>
+
+#include <sys/inotify.h>
+#include <sys/eventfd.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include "network.h"
+
+namespace NN {
+
+    // HOT RELOAD: watches a model file with inotify and, every time a new version lands,
+    // loads it on this background thread (mmap fast path) and hands it to `onReload`.
+    // The caller swaps it in (e.g. RcuCell::publish), so serving threads never stall.
+    //
+    // The DIRECTORY is watched, not the file: NeuralNetwork::save renames a finished temp
+    // file over the old one (IN_MOVED_TO), and the inode being watched would be the old one.
+    // Writers that rewrite the file in place are picked up on close (IN_CLOSE_WRITE).
+    // A file that fails to parse is skipped and the current model keeps serving.
+    class ModelWatcher {
+    public:
+        ModelWatcher(const std::string& path, std::function<void(NeuralNetwork&&)> onReload)
+        : filePath(path), callback(std::move(onReload)) {
+            const size_t slash = path.rfind('/');
+            directory = (slash == std::string::npos) ? "." : path.substr(0, slash);
+            fileName = (slash == std::string::npos) ? path : path.substr(slash + 1);
+
+            inotifyFd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+            stopFd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+            if (inotifyFd < 0 || stopFd < 0 ||
+                ::inotify_add_watch(inotifyFd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+                std::cerr << "Error: cannot watch " << directory << ": " << std::strerror(errno) << std::endl;
+                return;
+            }
+            worker = std::thread([this] { watchLoop(); });
+        }
+
+        ~ModelWatcher() {
+            if (worker.joinable()) {
+                uint64_t one = 1;
+                [[maybe_unused]] ssize_t n = ::write(stopFd, &one, sizeof(one));
+                worker.join();
+            }
+            if (inotifyFd >= 0) ::close(inotifyFd);
+            if (stopFd >= 0) ::close(stopFd);
+        }
+
+        ModelWatcher(const ModelWatcher&) = delete;
+        ModelWatcher& operator=(const ModelWatcher&) = delete;
+
+        bool watching() const { return worker.joinable(); }
+
+        // New versions handed over so far
+        int reloads() const { return reloadCount.load(); }
+
+    private:
+        std::string filePath;
+        std::string directory;
+        std::string fileName;
+        std::function<void(NeuralNetwork&&)> callback;
+        int inotifyFd = -1;
+        int stopFd = -1;
+        std::thread worker;
+        std::atomic<int> reloadCount{0};
+
+        void watchLoop() {
+            alignas(inotify_event) char buffer[4096];
+
+            while (true) {
+                pollfd fds[2] = {{inotifyFd, POLLIN, 0}, {stopFd, POLLIN, 0}};
+                if (::poll(fds, 2, -1) < 0) {
+                    if (errno == EINTR) continue;
+                    return;
+                }
+                if (fds[1].revents & POLLIN) return;
+
+                // 1. Drain the events, note whether our file was among them
+                bool changed = false;
+                ssize_t len;
+                while ((len = ::read(inotifyFd, buffer, sizeof(buffer))) > 0) {
+                    for (char* p = buffer; p < buffer + len;) {
+                        auto* event = reinterpret_cast<inotify_event*>(p);
+                        if (event->len > 0 && fileName == event->name) changed = true;
+                        p += sizeof(inotify_event) + event->len;
+                    }
+                }
+                if (!changed) continue;
+
+                // 2. Load off the serving path and hand it over
+                NeuralNetwork fresh;
+                if (fresh.loadMapped(filePath) && !fresh.layers.empty()) {
+                    callback(std::move(fresh));
+                    reloadCount.fetch_add(1);
+                }
+            }
+        }
+    };
+}
@@ -6,17 +6,29 @@
 #include <iostream>
 #include <random>
 #include <fstream>
-
+#include <variant>
+#include <cstdint>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+
+#include "activation.h"
+#include "mapped_file.h"
+#include "kernels.h"
+#include "conv.h"
+#include "pooling.h"
+#include "normalization.h"
+#include "dropout.h"
 
 namespace NN {
 
 
 
 
-    enum class ActivationType { Sigmoid = 's', Tanh = 't', ReLU = 'r', LeakyReLU = 'l' };
-
     class Layer {
     public:
+        static constexpr char tag = 'd';
+
         int numNodesIn;
         int numNodesOut;
         ActivationType actType;
@@ -54,162 +66,252 @@ namespace NN {
             this->lastInputs = inputs; // SAVE INPUTS for backprop
             std::vector<float> outputs(numNodesOut, 0.0f);
 
-            for (int out = 0; out < numNodesOut; out++) {
-                float sum = biases[out];
-                for (int in = 0; in < numNodesIn; in++) {
-                    sum += inputs[in] * weights[in * numNodesOut + out];
-                }
-                outputs[out] = activation(sum);
-            }
+            Kernels::parallelDenseForward(inputs.data(), weights.data(), biases.data(), outputs.data(),
+                                          numNodesIn, numNodesOut, actType);
+
             this->lastOutputs = outputs; // SAVE OUTPUTS
             return outputs;
         }
 
+        // Inference only: no memory kept, so many threads may call it at once
+        std::vector<float> infer(const std::vector<float>& inputs) const {
+            std::vector<float> outputs(numNodesOut, 0.0f);
+            Kernels::denseForward(inputs.data(), weights.data(), biases.data(), outputs.data(),
+                                  numNodesIn, numNodesOut, actType);
+            return outputs;
+        }
+
         // 2. BACKWARD PASS (Gradient Descent)
         // Returns: Gradients for the PREVIOUS layer
         // `l1` is the L1 regularization strength (lambda). If >0, apply L1 penalty to weights.
         std::vector<float> backPropagate(const std::vector<float>& outputGradients, float learningRate, float l1 = 0.0f) {
             std::vector<float> inputGradients(numNodesIn, 0.0f);
 
-            for (int out = 0; out < numNodesOut; out++) {
-                // Calculate 'delta' = error_term * derivative_of_activation
-                // We use lastOutputs[out] because Sigmoid derivative depends on the output value
-                float derivative = activationDerivative(lastOutputs[out]);
-                float delta = outputGradients[out] * derivative;
-
-                // Update Biases
-                biases[out] -= learningRate * delta;
-
-                // Update Weights AND Calculate Input Gradients
-                for (int in = 0; in < numNodesIn; in++) {
-                    int weightIndex = in * numNodesOut + out;
+            // Calculate 'delta' = error_term * derivative_of_activation
+            // We use lastOutputs because Sigmoid derivative depends on the output value
+            std::vector<float> delta(numNodesOut);
+            Kernels::parallelActivationDelta(outputGradients.data(), lastOutputs.data(), delta.data(), numNodesOut, actType);
 
-                    // Accumulate gradient to pass back to previous layer
-                    // (Chain Rule: dC/dInput = dC/dOutput * dOutput/dInput)
-                    inputGradients[in] += delta * weights[weightIndex];
+            // Input gradients use the weights BEFORE this step's update
+            Kernels::parallelDenseInputGradients(delta.data(), weights.data(), inputGradients.data(), numNodesIn, numNodesOut);
 
-                    // L1 regularization term (subgradient): lambda * sign(w)
-                    float l1term = 0.0f;
-                    if (l1 != 0.0f) {
-                        float w = weights[weightIndex];
-                        l1term = (w > 0.0f) ? 1.0f : (w < 0.0f ? -1.0f : 0.0f);
-                    }
-
-                    // Update Weight
-                    // W_new = W_old - learningRate * (delta * input + l1 * sign(w))
-                    weights[weightIndex] -= learningRate * (delta * lastInputs[in] + l1 * l1term);
-                }
-            }
+            // W_new = W_old - learningRate * (delta * input + l1 * sign(w))
+            Kernels::parallelDenseSgdUpdate(lastInputs.data(), delta.data(), weights.data(), biases.data(),
+                                            numNodesIn, numNodesOut, learningRate, l1);
             return inputGradients;
         }
 
-    private:
-        float activation(float x) {
-            switch (actType) {
-                case ActivationType::Tanh: return std::tanh(x);
-                case ActivationType::Sigmoid: return 1.0f / (1.0f + std::exp(-x));
-                case ActivationType::ReLU: return std::max(0.0f, x);
-                case ActivationType::LeakyReLU: return (x > 0) ? x : 0.01f * x;
-                default: return x;
-            }
+        void write(std::ostream& file) const {
+            // Save Architecture
+            file.write((char*)&numNodesIn, sizeof(int));
+            file.write((char*)&numNodesOut, sizeof(int));
+            file.write((char*)&actType, sizeof(ActivationType));
+
+            // Save Data
+            file.write((char*)weights.data(), weights.size() * sizeof(float));
+            file.write((char*)biases.data(), biases.size() * sizeof(float));
         }
 
-        // Calculates f'(x). Note: We pass the ACTIVATED value (y), not x, for efficiency
-        float activationDerivative(float y) {
-            switch (actType) {
-                case ActivationType::Tanh:
-                    return 1.0f - (y * y); // d/dx tanh(x) = 1 - tanh^2(x)
-                case ActivationType::Sigmoid:
-                    return y * (1.0f - y); // d/dx sig(x) = sig(x)(1 - sig(x))
-                case ActivationType::ReLU:
-                    return (y > 0.0f) ? 1.0f : 0.0f;
-                case ActivationType::LeakyReLU:
-                    return (y > 0.0f) ? 1.0f : 0.01f;
-                default: return 1.0f;
+        static Layer read(std::istream& file) {
+            int nIn, nOut;
+            ActivationType act;
+
+            // Read Architecture
+            file.read((char*)&nIn, sizeof(int));
+            file.read((char*)&nOut, sizeof(int));
+            file.read((char*)&act, sizeof(ActivationType));
+
+            // A corrupt header must not turn into a huge or negative allocation: the sizes
+            // have to be positive and the weights they imply must still be in the file
+            if (!file) throw std::invalid_argument("Layer: truncated header");
+            const std::streamoff left = streamBytesLeft(file);
+            const int64_t bytes = (int64_t(nIn) * nOut + nOut) * int64_t(sizeof(float));
+            if (nIn <= 0 || nOut <= 0 || (left >= 0 && bytes > left)) {
+                throw std::invalid_argument("Layer: invalid size " + std::to_string(nIn) + "x" + std::to_string(nOut));
             }
+
+            // Create Layer
+            Layer l(nIn, nOut, act);
+
+            // Read Data
+            file.read((char*)l.weights.data(), l.weights.size() * sizeof(float));
+            file.read((char*)l.biases.data(), l.biases.size() * sizeof(float));
+            return l;
         }
     };
 
+    // Every layer kind the network can chain. std::visit compiles to a jump table over
+    // these, so the hot loop has no virtual calls and the layers stay by value in one vector.
+    using AnyLayer = std::variant<Layer, ConvLayer, PoolLayer, NormLayer, DropoutLayer>;
+
     class NeuralNetwork {
     public:
 
-        std::vector<Layer> layers;
+        // "NNG1": marks the tagged file format. Old files start with the layer count instead.
+        static constexpr int32_t graphMagic = 0x31474E4E;
+
+        std::vector<AnyLayer> layers;
+
+        NeuralNetwork() = default;
 
         NeuralNetwork(const std::vector<int>& topology) {
             for (size_t i = 0; i < topology.size() - 1; i++) {
                 // Last layer usually Sigmoid/Linear, Hidden usually ReLU/Tanh
                 ActivationType act = (i == topology.size() - 2) ? ActivationType::Sigmoid : ActivationType::Tanh;
-                layers.emplace_back(topology[i], topology[i + 1], act);
+                layers.emplace_back(Layer(topology[i], topology[i + 1], act));
             }
         }
 
+        // Chain any layer kind, e.g. net.addLayer(NN::ConvLayer(1, 8, 28, 28, 3, act))
+        void addLayer(AnyLayer layer) {
+            layers.push_back(std::move(layer));
+        }
+
         std::vector<float> feedForward(std::vector<float> inputs) {
             for (auto& layer : layers) {
-                inputs = layer.calculateOutput(inputs);
+                inputs = std::visit([&](auto& l) { return l.calculateOutput(inputs); }, layer);
             }
             return inputs;
         }
+
+        // Thread-safe forward pass (no layer memory is written), used by the evaluators
+        std::vector<float> predict(std::vector<float> inputs) const {
+            for (auto& layer : layers) {
+                inputs = std::visit([&](const auto& l) { return l.infer(inputs); }, layer);
+            }
+            return inputs;
+        }
+
+        // Dropout only drops while training
+        void setTraining(bool training) {
+            for (auto& layer : layers) {
+                if (auto* d = std::get_if<DropoutLayer>(&layer)) d->training = training;
+            }
+        }
+
+        // Written to "<filename>.tmp" and renamed over the old file, so a process watching or
+        // loading the model never sees a half-written file.
         void save(const std::string& filename) {
-            std::ofstream file(filename, std::ios::binary);
+            const std::string tmpName = filename + ".tmp";
+            std::ofstream file(tmpName, std::ios::binary);
             if (!file.is_open()) {
                 std::cerr << "Error saving model!" << std::endl;
                 return;
             }
 
-            // 1. Save Number of Layers
+            // 1. Save Format Marker and Number of Layers
+            int32_t magic = graphMagic;
+            file.write((char*)&magic, sizeof(int32_t));
             int numLayers = layers.size();
             file.write((char*)&numLayers, sizeof(int));
 
-            // 2. Save Each Layer
+            // 2. Save Each Layer: 1-byte kind tag, then the layer's own data
             for (auto& layer : layers) {
-                // Save Architecture
-                file.write((char*)&layer.numNodesIn, sizeof(int));
-                file.write((char*)&layer.numNodesOut, sizeof(int));
-                file.write((char*)&layer.actType, sizeof(ActivationType));
-
-                // Save Data
-                file.write((char*)layer.weights.data(), layer.weights.size() * sizeof(float));
-                file.write((char*)layer.biases.data(), layer.biases.size() * sizeof(float));
+                std::visit([&](const auto& l) {
+                    char tag = l.tag;
+                    file.write(&tag, 1);
+                    l.write(file);
+                }, layer);
             }
             file.close();
+            if (!file || std::rename(tmpName.c_str(), filename.c_str()) != 0) {
+                std::cerr << "Error saving model!" << std::endl;
+                std::remove(tmpName.c_str());
+                return;
+            }
             std::cout << "Model saved to " << filename << std::endl;
         }
 
-        void load(const std::string& filename) {
+        bool load(const std::string& filename) {
             std::ifstream file(filename, std::ios::binary);
             if (!file.is_open()) {
                 std::cerr << "Error loading model!" << std::endl;
-                return;
+                return false;
             }
+            if (!read(file)) return false;
+            std::cout << "Model loaded from " << filename << std::endl;
+            return true;
+        }
 
-            layers.clear();
-            int numLayers;
-            file.read((char*)&numLayers, sizeof(int));
-
-            for (int i = 0; i < numLayers; i++) {
-                int nIn, nOut;
-                ActivationType act;
+        // FAST PATH: parses the file straight out of an mmap (no stream buffering copies)
+        bool loadMapped(const std::string& filename) {
+            MappedFile mapped(filename);
+            if (!mapped.isOpen()) {
+                std::cerr << "Error loading model!" << std::endl;
+                return false;
+            }
+            MemoryStreamBuf buffer(mapped.data(), mapped.size());
+            std::istream file(&buffer);
+            if (!read(file)) return false;
+            std::cout << "Model loaded from " << filename << " (mapped)" << std::endl;
+            return true;
+        }
 
-                // Read Architecture
-                file.read((char*)&nIn, sizeof(int));
-                file.read((char*)&nOut, sizeof(int));
-                file.read((char*)&act, sizeof(ActivationType));
+        // Both file formats; on a truncated or unknown file `layers` ends up empty
+        bool read(std::istream& file) {
+            layers.clear();
+            int32_t header = 0;
+            file.read((char*)&header, sizeof(int32_t));
+
+            // Old dense-only files: layer count, then untagged dense layers
+            if (header != graphMagic) {
+                try {
+                    for (int i = 0; i < header && file; i++) {
+                        layers.emplace_back(Layer::read(file));
+                    }
+                } catch (const std::exception& e) {
+                    std::cerr << "Error loading model: " << e.what() << std::endl;
+                    layers.clear();
+                    return false;
+                }
+                if (!file) {
+                    std::cerr << "Error loading model: file is truncated" << std::endl;
+                    layers.clear();
+                    return false;
+                }
+                return true;
+            }
 
-                // Create Layer
-                layers.emplace_back(nIn, nOut, act);
+            int numLayers = 0;
+            file.read((char*)&numLayers, sizeof(int));
 
-                // Read Data
-                auto& l = layers.back();
-                file.read((char*)l.weights.data(), l.weights.size() * sizeof(float));
-                file.read((char*)l.biases.data(), l.biases.size() * sizeof(float));
+            for (int i = 0; i < numLayers && file; i++) {
+                char tag = 0;
+                file.read(&tag, 1);
+                try {
+                    switch (tag) {
+                        case Layer::tag: layers.emplace_back(Layer::read(file)); break;
+                        case ConvLayer::tag: layers.emplace_back(ConvLayer::read(file)); break;
+                        case PoolLayer::tag: layers.emplace_back(PoolLayer::read(file)); break;
+                        case NormLayer::tag: layers.emplace_back(NormLayer::read(file)); break;
+                        case DropoutLayer::tag: layers.emplace_back(DropoutLayer::read(file)); break;
+                        default:
+                            std::cerr << "Error loading model: unknown layer type '" << tag << "'" << std::endl;
+                            layers.clear();
+                            return false;
+                    }
+                } catch (const std::exception& e) {
+                    // Layer readers reject sizes they cannot run (corrupt file); anything a
+                    // check misses (bad_alloc, length_error) is a load error too, never a crash
+                    // of the caller's thread (ModelWatcher reloads in the background)
+                    std::cerr << "Error loading model: " << e.what() << std::endl;
+                    layers.clear();
+                    return false;
+                }
             }
-            file.close();
-            std::cout << "Model loaded from " << filename << std::endl;
+            if (!file) {
+                std::cerr << "Error loading model: file is truncated" << std::endl;
+                layers.clear();
+                return false;
+            }
+            return true;
         }
 
 
         // THE TRAINING FUNCTION
         void train(const std::vector<float>& inputs, const std::vector<float>& targets, float learningRate, float l1 = 0.0f) {
+            setTraining(true);
+
             // 1. Forward Pass (Fill the "memory" of the layers)
             std::vector<float> results = feedForward(inputs);
 
@@ -222,8 +324,10 @@ namespace NN {
 
             // 3. Backward Pass (Loop reversed)
             for (int i = layers.size() - 1; i >= 0; i--) {
-                gradients = layers[i].backPropagate(gradients, learningRate, l1);
+                gradients = std::visit([&](auto& l) { return l.backPropagate(gradients, learningRate, l1); }, layers[i]);
             }
+
+            setTraining(false);
         }
     };
 }
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <vector>
+#include <cmath>
+#include <fstream>
+
+namespace NN {
+
+    // Layer Normalization: y = gamma * (x - mean) / sqrt(var + eps) + beta
+    // The statistics are taken over the features of ONE sample, because we train one
+    // sample at a time (batch statistics over a batch of 1 would be meaningless).
+    class NormLayer {
+    public:
+        static constexpr char tag = 'n';
+
+        int size;
+        float epsilon;
+
+        std::vector<float> gamma; // learnable scale
+        std::vector<float> beta;  // learnable shift
+
+        // MEMORY: normalized inputs and 1/std are all the backward pass needs
+        std::vector<float> lastNormalized;
+        float lastInvStd = 1.0f;
+
+        NormLayer(int n, float eps = 1e-5f)
+        : size(n), epsilon(eps), gamma(n, 1.0f), beta(n, 0.0f) {}
+
+        // 1. FORWARD PASS
+        std::vector<float> calculateOutput(const std::vector<float>& inputs) {
+            float mean = 0.0f;
+            for (float v : inputs) mean += v;
+            mean /= size;
+
+            float var = 0.0f;
+            for (float v : inputs) var += (v - mean) * (v - mean);
+            var /= size;
+
+            lastInvStd = 1.0f / std::sqrt(var + epsilon);
+            lastNormalized.resize(size);
+            std::vector<float> outputs(size);
+            for (int i = 0; i < size; i++) {
+                lastNormalized[i] = (inputs[i] - mean) * lastInvStd;
+                outputs[i] = gamma[i] * lastNormalized[i] + beta[i];
+            }
+            return outputs;
+        }
+
+        // Inference only: no memory kept, so many threads may call it at once
+        std::vector<float> infer(const std::vector<float>& inputs) const {
+            float mean = 0.0f;
+            for (float v : inputs) mean += v;
+            mean /= size;
+
+            float var = 0.0f;
+            for (float v : inputs) var += (v - mean) * (v - mean);
+            var /= size;
+
+            const float invStd = 1.0f / std::sqrt(var + epsilon);
+            std::vector<float> outputs(size);
+            for (int i = 0; i < size; i++) {
+                outputs[i] = gamma[i] * (inputs[i] - mean) * invStd + beta[i];
+            }
+            return outputs;
+        }
+
+        // 2. BACKWARD PASS
+        // dx = invStd / n * (n * dxhat - sum(dxhat) - xhat * sum(dxhat * xhat))
+        std::vector<float> backPropagate(const std::vector<float>& outputGradients, float learningRate, float /*l1*/ = 0.0f) {
+            std::vector<float> dxhat(size);
+            float sumDxhat = 0.0f;
+            float sumDxhatXhat = 0.0f;
+            for (int i = 0; i < size; i++) {
+                dxhat[i] = outputGradients[i] * gamma[i];
+                sumDxhat += dxhat[i];
+                sumDxhatXhat += dxhat[i] * lastNormalized[i];
+            }
+
+            std::vector<float> inputGradients(size);
+            for (int i = 0; i < size; i++) {
+                inputGradients[i] = lastInvStd / size * (size * dxhat[i] - sumDxhat - lastNormalized[i] * sumDxhatXhat);
+
+                // Update scale and shift
+                gamma[i] -= learningRate * outputGradients[i] * lastNormalized[i];
+                beta[i] -= learningRate * outputGradients[i];
+            }
+            return inputGradients;
+        }
+
+        void write(std::ostream& file) const {
+            file.write((char*)&size, sizeof(int));
+            file.write((char*)&epsilon, sizeof(float));
+            file.write((char*)gamma.data(), gamma.size() * sizeof(float));
+            file.write((char*)beta.data(), beta.size() * sizeof(float));
+        }
+
+        static NormLayer read(std::istream& file) {
+            int n;
+            float eps;
+            file.read((char*)&n, sizeof(int));
+            file.read((char*)&eps, sizeof(float));
+            NormLayer l(n, eps);
+            file.read((char*)l.gamma.data(), l.gamma.size() * sizeof(float));
+            file.read((char*)l.beta.data(), l.beta.size() * sizeof(float));
+            return l;
+        }
+    };
+}
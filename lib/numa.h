@@ -0,0 +1,74 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <algorithm>
+#include <filesystem>
+
+#include <pthread.h>
+#include <sched.h>
+
+namespace NN {
+
+    // NUMA topology read straight from sysfs, so there is no libnuma dependency.
+    //
+    // PLACEMENT: Linux puts a page on the node of the thread that first WRITES it.
+    // So "allocate on node N" just means: pin a thread to node N's cores, then create
+    // (and zero/fill) the buffer from that thread.
+    struct NumaTopology {
+        std::vector<std::vector<int>> nodeCpus; // nodeCpus[node] = cpu ids
+
+        int numNodes() const { return static_cast<int>(nodeCpus.size()); }
+
+        static NumaTopology detect() {
+            NumaTopology topo;
+            const std::string base = "/sys/devices/system/node/";
+            std::error_code ec;
+
+            for (int node = 0;; node++) {
+                std::string path = base + "node" + std::to_string(node) + "/cpulist";
+                if (!std::filesystem::exists(path, ec)) break;
+                std::ifstream file(path);
+                std::string list;
+                std::getline(file, list);
+                std::vector<int> cpus = parseCpuList(list);
+                if (!cpus.empty()) topo.nodeCpus.push_back(cpus);
+            }
+
+            // No sysfs (containers, non-Linux): one node with every core
+            if (topo.nodeCpus.empty()) {
+                std::vector<int> cpus;
+                int n = std::max(1u, std::thread::hardware_concurrency());
+                for (int i = 0; i < n; i++) cpus.push_back(i);
+                topo.nodeCpus.push_back(cpus);
+            }
+            return topo;
+        }
+
+        // "0-3,8,10-11" -> {0,1,2,3,8,10,11}
+        static std::vector<int> parseCpuList(const std::string& list) {
+            std::vector<int> cpus;
+            std::stringstream ss(list);
+            std::string part;
+            while (std::getline(ss, part, ',')) {
+                if (part.empty()) continue;
+                size_t dash = part.find('-');
+                int lo = std::stoi(part.substr(0, dash));
+                int hi = (dash == std::string::npos) ? lo : std::stoi(part.substr(dash + 1));
+                for (int c = lo; c <= hi; c++) cpus.push_back(c);
+            }
+            return cpus;
+        }
+    };
+
+    // Pin the calling thread to one core. Returns false if the kernel refused.
+    inline bool pinThisThread(int cpu) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+    }
+}
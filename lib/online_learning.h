@@ -0,0 +1,197 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <random>
+#include <string>
+#include <functional>
+#include <algorithm>
+#include <iostream>
+
+#include "network.h"
+#include "gradients.h"
+#include "snapshot.h"
+#include "image_processing.h"
+
+namespace NN {
+
+    // Fixed-size ring of labelled samples; the oldest is overwritten once it is full
+    class ReplayBuffer {
+    public:
+        explicit ReplayBuffer(size_t cap = 512) : capacity(cap) {}
+
+        void add(const std::vector<float>& pixels, int label) {
+            ImgProc::Image img;
+            img.pixels = pixels;
+            img.label = label;
+            img.target.assign(10, 0.0f);
+            img.target[label] = 1.0f;
+
+            std::lock_guard<std::mutex> lock(mutex);
+            if (samples.size() < capacity) samples.push_back(std::move(img));
+            else samples[next] = std::move(img);
+            next = (next + 1) % capacity;
+            added++;
+        }
+
+        size_t size() const {
+            std::lock_guard<std::mutex> lock(mutex);
+            return samples.size();
+        }
+
+        size_t totalAdded() const {
+            std::lock_guard<std::mutex> lock(mutex);
+            return added;
+        }
+
+        // n random samples (copied, so the caller can train without holding the lock)
+        std::vector<ImgProc::Image> sample(size_t n, std::mt19937& rng) const {
+            std::lock_guard<std::mutex> lock(mutex);
+            std::vector<ImgProc::Image> out;
+            if (samples.empty()) return out;
+            std::uniform_int_distribution<size_t> pick(0, samples.size() - 1);
+            for (size_t i = 0; i < n; i++) out.push_back(samples[pick(rng)]);
+            return out;
+        }
+
+    private:
+        size_t capacity;
+        size_t next = 0;
+        size_t added = 0;
+        std::vector<ImgProc::Image> samples;
+        mutable std::mutex mutex;
+    };
+
+    // Online fine-tuning while the model keeps serving.
+    //
+    // SERVING vs SHADOW: readers get an immutable snapshot (current()) and only ever call
+    // predict() on it. A background thread fine-tunes its own SHADOW copy with small batches
+    // that mix the user's samples with MNIST replay (so the model doesn't forget the digits
+    // it already knew), then publishes it through an RcuCell: one atomic pointer swap,
+    // readers never lock or wait for training, and an old snapshot is only recycled once
+    // its last reader has let go of it.
+    class OnlineTrainer {
+    public:
+        float learningRate = 0.2f; // applied to the batch mean
+        int batchSize = 8;
+        int userPerBatch = 4;     // the rest of each batch is MNIST replay
+        int stepsPerRound = 40;   // batches between two publishes
+
+        // `loadReplay` runs on the background thread (e.g. loading MNIST) so startup doesn't stall
+        OnlineTrainer(const NeuralNetwork& model, std::function<std::vector<ImgProc::Image>()> loadReplay = nullptr)
+        : shadow(model), serving(model), replayLoader(std::move(loadReplay)) {
+            worker = std::thread([this] { trainLoop(); });
+        }
+
+        ~OnlineTrainer() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stop = true;
+            }
+            cv.notify_all();
+            worker.join();
+        }
+
+        OnlineTrainer(const OnlineTrainer&) = delete;
+        OnlineTrainer& operator=(const OnlineTrainer&) = delete;
+
+        // Snapshot to predict with (lock-free; hold it only as long as you need it)
+        RcuCell<NeuralNetwork>::ReadGuard current() const { return serving.read(); }
+
+        // Incremented on every publish
+        int version() const { return static_cast<int>(serving.versions()); }
+
+        size_t userSamples() const { return userBuffer.totalAdded(); }
+
+        // A new base model (e.g. hot-reloaded from disk): served right away, and the trainer
+        // continues from it. A round that was running on the old model is not published.
+        void replaceModel(NeuralNetwork&& model) {
+            std::lock_guard<std::mutex> lock(mutex);
+            serving.publish(static_cast<const NeuralNetwork&>(model));
+            replacement = std::make_unique<NeuralNetwork>(std::move(model));
+        }
+
+        // A labelled sample from the user; wakes the trainer
+        void addSample(const std::vector<float>& pixels, int label) {
+            if (label < 0 || label > 9) return;
+            userBuffer.add(pixels, label);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                pendingRounds = 3; // a few rounds per new sample, then go idle again
+            }
+            cv.notify_all();
+        }
+
+    private:
+        NeuralNetwork shadow; // only touched by the background thread
+        RcuCell<NeuralNetwork> serving;
+        std::function<std::vector<ImgProc::Image>()> replayLoader;
+        std::vector<ImgProc::Image> replay;
+        ReplayBuffer userBuffer;
+
+        std::thread worker;
+        std::mutex mutex;
+        std::condition_variable cv;
+        int pendingRounds = 0;
+        bool stop = false;
+        std::unique_ptr<NeuralNetwork> replacement; // set by replaceModel, adopted by the trainer
+
+        void trainLoop() {
+            if (replayLoader) replay = replayLoader();
+            std::mt19937 rng(std::random_device{}());
+            std::uniform_int_distribution<size_t> pickReplay(0, replay.empty() ? 0 : replay.size() - 1);
+            bool batched = false;
+            std::unique_ptr<GradientBuffer> grads;
+            std::unique_ptr<GradientScratch> scratch;
+            auto prepare = [&] {
+                batched = supportsGradients(shadow);
+                grads = batched ? std::make_unique<GradientBuffer>(shadow) : nullptr;
+                scratch = batched ? std::make_unique<GradientScratch>(shadow) : nullptr;
+            };
+            prepare();
+
+            while (true) {
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    cv.wait(lock, [&] { return stop || pendingRounds > 0; });
+                    if (stop) return;
+                    pendingRounds--;
+                    if (replacement) {
+                        shadow = std::move(*replacement); // the topology may have changed
+                        replacement.reset();
+                        prepare();
+                    }
+                }
+
+                // 1. Fine-tune the shadow copy
+                for (int step = 0; step < stepsPerRound; step++) {
+                    std::vector<ImgProc::Image> user = userBuffer.sample(userPerBatch, rng);
+                    std::vector<const ImgProc::Image*> batch;
+                    for (auto& img : user) batch.push_back(&img);
+                    for (int i = static_cast<int>(batch.size()); i < batchSize && !replay.empty(); i++) {
+                        batch.push_back(&replay[pickReplay(rng)]);
+                    }
+                    if (batch.empty()) continue;
+
+                    if (batched) {
+                        grads->zero();
+                        for (auto* img : batch) {
+                            accumulateGradients(shadow, img->pixels.data(), img->target.data(), *grads, *scratch);
+                        }
+                        applyGradients(shadow, grads->data.data(), learningRate / batch.size());
+                    } else {
+                        for (auto* img : batch) shadow.train(img->pixels, img->target, learningRate);
+                    }
+                }
+
+                // 2. Publish: readers switch over on their next current()
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!replacement) serving.publish(shadow);
+            }
+        }
+    };
+}
@@ -0,0 +1,198 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <thread>
+#include <barrier>
+#include <random>
+#include <algorithm>
+#include <iostream>
+
+#include "network.h"
+#include "gradients.h"
+#include "numa.h"
+#include "image_processing.h"
+
+namespace NN {
+
+    // Synchronous data-parallel mini-batch SGD, NUMA aware.
+    //
+    // LAYOUT: every worker thread is pinned to one core. Each NUMA node gets its own shard of
+    // the dataset (flat floats) and its own gradient buffers, all created by a thread of that
+    // node so the pages land locally. Every worker trains on a private replica of the network.
+    //
+    // ONE STEP:
+    //   1. every worker accumulates gradients for its micro-batch (only local memory)
+    //   2. intra-node reduce: the node's workers sum their gradients into the node buffer
+    //   3. cross-node reduce: each node sums ALL node buffers into its own reduced copy,
+    //      so every remote byte crosses the interconnect once per node, not once per core
+    //   4. every worker applies the (identical) reduced gradient to its replica
+    class DataParallelTrainer {
+    public:
+        NeuralNetwork& net;
+        NumaTopology topology;
+        int numThreads;
+
+        // threads = 0 uses every core of every node
+        DataParallelTrainer(NeuralNetwork& network, int threads = 0)
+        : net(network), topology(NumaTopology::detect()) {
+            int cores = 0;
+            for (auto& cpus : topology.nodeCpus) cores += static_cast<int>(cpus.size());
+            numThreads = (threads > 0) ? threads : cores;
+        }
+
+        void train(const std::vector<ImgProc::Image>& dataset, int epochs, int batchSize, float learningRate) {
+            if (!supportsGradients(net)) {
+                std::cerr << "Error: DataParallelTrainer only supports dense layers." << std::endl;
+                return;
+            }
+            if (dataset.empty()) return;
+
+            // 1. Spread the workers round-robin over the nodes
+            const int numNodes = std::min(topology.numNodes(), numThreads);
+            std::vector<Worker> workers(numThreads);
+            std::vector<int> nodeWorkers(numNodes, 0);
+            for (int w = 0; w < numThreads; w++) {
+                Worker& wk = workers[w];
+                wk.node = w % numNodes;
+                wk.rank = nodeWorkers[wk.node]++;
+                const auto& cpus = topology.nodeCpus[wk.node];
+                wk.cpu = cpus[wk.rank % cpus.size()];
+            }
+
+            // 2. Work out how many steps every worker can do per epoch
+            const int micro = std::max(1, (batchSize + numThreads - 1) / numThreads);
+            const int globalBatch = micro * numThreads;
+            int stepsPerEpoch = static_cast<int>(dataset.size());
+            for (int n = 0; n < numNodes; n++) {
+                int shardSize = static_cast<int>((dataset.size() + numNodes - 1 - n) / numNodes);
+                int perWorker = shardSize / nodeWorkers[n];
+                stepsPerEpoch = std::min(stepsPerEpoch, perWorker / micro);
+            }
+            if (stepsPerEpoch == 0) {
+                std::cerr << "Error: dataset too small for " << numThreads << " workers." << std::endl;
+                return;
+            }
+
+            std::vector<std::unique_ptr<NodeState>> nodes(numNodes);
+            std::barrier<> barrier(numThreads);
+            std::vector<std::thread> threads;
+
+            std::cout << "Data-parallel training: " << numThreads << " threads on " << numNodes
+                      << " NUMA node(s), batch " << globalBatch << std::endl;
+
+            for (int w = 0; w < numThreads; w++) {
+                threads.emplace_back([&, w] {
+                    Worker& me = workers[w];
+                    pinThisThread(me.cpu);
+
+                    // SETUP: node leaders build the node shard, everyone builds their own state
+                    if (me.rank == 0) {
+                        nodes[me.node] = std::make_unique<NodeState>(dataset, me.node, numNodes, net);
+                    }
+                    me.replica = std::make_unique<NeuralNetwork>(net);
+                    me.grads = std::make_unique<GradientBuffer>(*me.replica);
+                    me.scratch = std::make_unique<GradientScratch>(*me.replica);
+                    barrier.arrive_and_wait();
+
+                    NodeState& node = *nodes[me.node];
+                    const int nw = nodeWorkers[me.node];
+                    const size_t G = me.grads->size();
+                    const size_t begin = G * me.rank / nw;
+                    const size_t end = G * (me.rank + 1) / nw;
+                    const size_t inSize = node.inputSize;
+                    const size_t outSize = node.targetSize;
+
+                    for (int e = 0; e < epochs; e++) {
+                        if (me.rank == 0) std::shuffle(node.order.begin(), node.order.end(), node.rng);
+                        barrier.arrive_and_wait();
+                        // Only now: worker 0 reads every loss after the previous epoch's last barrier
+                        me.loss = 0.0f;
+
+                        for (int step = 0; step < stepsPerEpoch; step++) {
+                            // 1. Local gradients
+                            me.grads->zero();
+                            for (int s = 0; s < micro; s++) {
+                                size_t j = me.rank + static_cast<size_t>(nw) * (static_cast<size_t>(step) * micro + s);
+                                size_t idx = node.order[j];
+                                me.loss += accumulateGradients(*me.replica, &node.inputs[idx * inSize], &node.targets[idx * outSize],
+                                                               *me.grads, *me.scratch);
+                            }
+                            barrier.arrive_and_wait();
+
+                            // 2. Intra-node reduce (my slice of the buffer)
+                            for (size_t k = begin; k < end; k++) {
+                                float sum = 0.0f;
+                                for (auto& other : workers) {
+                                    if (other.node == me.node) sum += other.grads->data[k];
+                                }
+                                node.nodeGrad[k] = sum;
+                            }
+                            barrier.arrive_and_wait();
+
+                            // 3. Cross-node reduce into this node's copy
+                            for (size_t k = begin; k < end; k++) {
+                                float sum = 0.0f;
+                                for (auto& other : nodes) sum += other->nodeGrad[k];
+                                node.reduced[k] = sum;
+                            }
+                            barrier.arrive_and_wait();
+
+                            // 4. Same update on every replica
+                            applyGradients(*me.replica, node.reduced.data(), learningRate / globalBatch);
+                        }
+                        barrier.arrive_and_wait();
+
+                        if (w == 0) {
+                            float total = 0.0f;
+                            for (auto& other : workers) total += other.loss;
+                            std::cout << "Epoch " << (e + 1) << "/" << epochs << " loss "
+                                      << total / (static_cast<float>(stepsPerEpoch) * globalBatch) << std::endl;
+                        }
+                    }
+
+                    // All replicas are identical, hand one back
+                    if (w == 0) net = *me.replica;
+                });
+            }
+            for (auto& t : threads) t.join();
+        }
+
+    private:
+        struct Worker {
+            int node = 0;
+            int rank = 0; // index inside its node
+            int cpu = 0;
+            float loss = 0.0f;
+            std::unique_ptr<NeuralNetwork> replica;
+            std::unique_ptr<GradientBuffer> grads;
+            std::unique_ptr<GradientScratch> scratch;
+        };
+
+        // Everything here is created (first touched) by a thread pinned to the node
+        struct NodeState {
+            size_t inputSize;
+            size_t targetSize;
+            std::vector<float> inputs;  // [count][inputSize]
+            std::vector<float> targets; // [count][targetSize]
+            std::vector<size_t> order;
+            std::vector<float> nodeGrad;
+            std::vector<float> reduced;
+            std::mt19937 rng;
+
+            NodeState(const std::vector<ImgProc::Image>& dataset, int node, int numNodes, const NeuralNetwork& net)
+            : rng(std::random_device{}() + node) {
+                inputSize = dataset[0].pixels.size();
+                targetSize = dataset[0].target.size();
+                for (size_t i = node; i < dataset.size(); i += numNodes) {
+                    inputs.insert(inputs.end(), dataset[i].pixels.begin(), dataset[i].pixels.end());
+                    targets.insert(targets.end(), dataset[i].target.begin(), dataset[i].target.end());
+                    order.push_back(order.size());
+                }
+                GradientBuffer shape(net);
+                nodeGrad.assign(shape.size(), 0.0f);
+                reduced.assign(shape.size(), 0.0f);
+            }
+        };
+    };
+}
@@ -0,0 +1,341 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <functional>
+#include <iostream>
+#include <cstring>
+#include <cstdint>
+#include <new>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "network.h"
+#include "gradients.h"
+#include "image_processing.h"
+
+namespace NN {
+
+    // Parameters of a dense NeuralNetwork in POSIX shared memory, so a parameter-server
+    // process and any number of worker processes on the same host can see them.
+    //
+    // LAYOUT:  [Header] [weights: numParams floats] [Slot 0] [Slot 1] ...
+    // Weights are published with a SEQLOCK: the server makes `seq` odd while it writes and
+    // even again when done; readers copy and retry if `seq` moved, so they never keep a
+    // half-updated (torn) snapshot and never block the server.
+    // Every worker owns one gradient Slot; `full` hands it back and forth (0 worker, 1 server).
+    class SharedParameters {
+    public:
+        static constexpr uint32_t magic = 0x31535050; // "PPS1"
+
+        struct Header {
+            uint32_t magic;
+            uint32_t numWorkers;
+            uint64_t numParams;
+            std::atomic<uint64_t> seq;
+            std::atomic<uint64_t> version;     // updates applied so far
+            std::atomic<uint32_t> workersDone;
+            std::atomic<uint32_t> dropped;     // gradients rejected as too stale
+        };
+
+        struct Slot {
+            std::atomic<uint32_t> full;
+            uint32_t samples;
+            uint64_t baseVersion; // version of the snapshot the gradient was computed on
+            float loss;
+            // followed by numParams floats
+        };
+
+        SharedParameters() = default;
+        SharedParameters(const SharedParameters&) = delete;
+        SharedParameters& operator=(const SharedParameters&) = delete;
+
+        ~SharedParameters() {
+            if (base) ::munmap(base, bytes);
+            if (owner) ::shm_unlink(name.c_str());
+        }
+
+        // SERVER: create the region and fill it with `net`'s parameters
+        bool create(const std::string& shmName, const NeuralNetwork& net, int numWorkers) {
+            name = shmName;
+            const size_t n = GradientBuffer(net).size();
+            ::shm_unlink(name.c_str());
+            int fd = ::shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+            if (fd < 0) {
+                std::cerr << "Error: shm_open " << name << ": " << std::strerror(errno) << std::endl;
+                return false;
+            }
+            bytes = layoutSize(n, numWorkers);
+            if (::ftruncate(fd, bytes) < 0 || !map(fd)) {
+                ::close(fd);
+                return false;
+            }
+            ::close(fd);
+            owner = true;
+
+            Header* h = new (base) Header();
+            h->numWorkers = numWorkers;
+            h->numParams = n;
+            h->seq.store(0);
+            h->version.store(0);
+            h->workersDone.store(0);
+            h->dropped.store(0);
+            for (int w = 0; w < numWorkers; w++) new (slot(w)) Slot();
+            flatten(net, weights());
+            std::atomic_thread_fence(std::memory_order_release);
+            h->magic = magic; // last: attach() waits for it
+            return true;
+        }
+
+        // WORKER (other process): map an existing region, waiting up to 30 s for the server
+        bool attach(const std::string& shmName) {
+            name = shmName;
+            const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(30);
+            auto wait = [&] {
+                std::this_thread::sleep_for(std::chrono::milliseconds(50));
+                return std::chrono::steady_clock::now() < deadline;
+            };
+
+            // 1. The region exists and has been sized
+            int fd = -1;
+            struct stat st{};
+            while ((fd = ::shm_open(name.c_str(), O_RDWR, 0600)) < 0 || ::fstat(fd, &st) < 0 || st.st_size == 0) {
+                if (fd >= 0) ::close(fd);
+                if (!wait()) {
+                    std::cerr << "Error: no parameter server at " << name << std::endl;
+                    return false;
+                }
+            }
+            bytes = st.st_size;
+            bool ok = map(fd);
+            ::close(fd);
+            if (!ok) return false;
+
+            // 2. The server has finished filling it in
+            while (reinterpret_cast<volatile uint32_t*>(base)[0] != magic) {
+                if (!wait()) {
+                    std::cerr << "Error: " << name << " is not a parameter server region." << std::endl;
+                    return false;
+                }
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            return true;
+        }
+
+        Header* header() const { return static_cast<Header*>(base); }
+        float* weights() const { return reinterpret_cast<float*>(static_cast<char*>(base) + headerSize()); }
+        size_t numParams() const { return header()->numParams; }
+
+        Slot* slot(int w) const {
+            char* first = reinterpret_cast<char*>(weights()) + roundUp(header()->numParams * sizeof(float));
+            return reinterpret_cast<Slot*>(first + w * slotSize(header()->numParams));
+        }
+        float* slotGrads(int w) const { return reinterpret_cast<float*>(reinterpret_cast<char*>(slot(w)) + roundUp(sizeof(Slot))); }
+
+        // Consistent copy of the weights, returns the version it belongs to
+        uint64_t readSnapshot(float* out) const {
+            Header* h = header();
+            while (true) {
+                uint64_t before = h->seq.load(std::memory_order_acquire);
+                if (before & 1) {
+                    std::this_thread::yield();
+                    continue;
+                }
+                uint64_t version = h->version.load(std::memory_order_relaxed);
+                std::memcpy(out, weights(), numParams() * sizeof(float));
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (h->seq.load(std::memory_order_relaxed) == before) return version;
+            }
+        }
+
+        // [W0 | b0 | W1 | b1 | ...], same order as GradientBuffer
+        static void flatten(const NeuralNetwork& net, float* out) {
+            for (auto& layer : net.layers) {
+                const Layer& l = std::get<Layer>(layer);
+                out = std::copy(l.weights.begin(), l.weights.end(), out);
+                out = std::copy(l.biases.begin(), l.biases.end(), out);
+            }
+        }
+
+        static void unflatten(const float* in, NeuralNetwork& net) {
+            for (auto& layer : net.layers) {
+                Layer& l = std::get<Layer>(layer);
+                std::copy(in, in + l.weights.size(), l.weights.begin());
+                in += l.weights.size();
+                std::copy(in, in + l.biases.size(), l.biases.begin());
+                in += l.biases.size();
+            }
+        }
+
+    private:
+        void* base = nullptr;
+        size_t bytes = 0;
+        bool owner = false;
+        std::string name;
+
+        static size_t roundUp(size_t n) { return (n + 63) & ~size_t(63); }
+        static size_t headerSize() { return roundUp(sizeof(Header)); }
+        static size_t slotSize(size_t n) { return roundUp(sizeof(Slot)) + roundUp(n * sizeof(float)); }
+        static size_t layoutSize(size_t n, int workers) { return headerSize() + roundUp(n * sizeof(float)) + workers * slotSize(n); }
+
+        bool map(int fd) {
+            base = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            if (base == MAP_FAILED) {
+                base = nullptr;
+                std::cerr << "Error: mmap " << name << ": " << std::strerror(errno) << std::endl;
+                return false;
+            }
+            return true;
+        }
+    };
+
+    // Asynchronous SGD server. Applies every worker gradient as soon as it arrives, unless it
+    // was computed on weights more than `maxStaleness` updates old (BOUNDED STALENESS: it is
+    // dropped, and the worker starts its next step from a fresh snapshot anyway).
+    class ParameterServer {
+    public:
+        SharedParameters& params;
+        float learningRate;
+        uint64_t maxStaleness;
+
+        ParameterServer(SharedParameters& p, float lr, uint64_t staleness = 4)
+        : params(p), learningRate(lr), maxStaleness(staleness) {}
+
+        // Runs until every worker has called finish(), or until `exitedWorkers` (how many worker
+        // processes are gone, crashed or not) reaches numWorkers: a worker that dies early never
+        // finishes. Copies the final weights into `net`.
+        void serve(NeuralNetwork& net, const std::function<int()>& exitedWorkers = {}) {
+            auto* h = params.header();
+            const int W = static_cast<int>(h->numWorkers);
+            const size_t n = params.numParams();
+            float* w = params.weights();
+            uint64_t applied = 0;
+            double lossSum = 0.0;
+            uint64_t samples = 0;
+            int idle = 0;
+
+            while (true) {
+                bool progress = false;
+                for (int k = 0; k < W; k++) {
+                    auto* s = params.slot(k);
+                    if (s->full.load(std::memory_order_acquire) == 0) continue;
+                    progress = true;
+
+                    const uint64_t version = h->version.load(std::memory_order_relaxed);
+                    if (version - s->baseVersion <= maxStaleness) {
+                        // 1. Publish: seq odd -> write -> seq even
+                        const float* g = params.slotGrads(k);
+                        const float scale = learningRate / s->samples;
+                        h->seq.fetch_add(1, std::memory_order_acq_rel);
+                        for (size_t i = 0; i < n; i++) w[i] -= scale * g[i];
+                        h->version.store(version + 1, std::memory_order_relaxed);
+                        h->seq.fetch_add(1, std::memory_order_release);
+
+                        applied++;
+                        lossSum += s->loss;
+                        samples += s->samples;
+                        if (applied % 1000 == 0) {
+                            std::cout << "Server: " << applied << " updates, loss " << lossSum / samples
+                                      << ", dropped " << h->dropped.load() << std::endl;
+                            lossSum = 0.0;
+                            samples = 0;
+                        }
+                    } else {
+                        h->dropped.fetch_add(1, std::memory_order_relaxed);
+                    }
+                    // 2. Slot back to the worker
+                    s->full.store(0, std::memory_order_release);
+                }
+
+                if (!progress) {
+                    if (h->workersDone.load(std::memory_order_acquire) == static_cast<uint32_t>(W)) break;
+                    if (++idle < 1000) std::this_thread::yield();
+                    else if (exitedWorkers && exitedWorkers() >= W) break; // nobody left to push
+                    else std::this_thread::sleep_for(std::chrono::microseconds(50));
+                } else {
+                    idle = 0;
+                }
+            }
+
+            std::cout << "Server: " << applied << " updates applied, " << h->dropped.load() << " dropped as stale" << std::endl;
+            const uint32_t done = h->workersDone.load();
+            if (done < static_cast<uint32_t>(W)) {
+                std::cerr << "Server: " << W - done << " worker(s) exited without finishing" << std::endl;
+            }
+            SharedParameters::unflatten(w, net);
+        }
+    };
+
+    // One asynchronous worker: pull a snapshot, compute a mini-batch gradient, push it, repeat.
+    // Never waits for the other workers, so a slow core only slows itself down.
+    class AsyncWorker {
+    public:
+        SharedParameters& params;
+        NeuralNetwork& replica; // same topology as the server's network
+        int id;
+
+        AsyncWorker(SharedParameters& p, NeuralNetwork& net, int workerId) : params(p), replica(net), id(workerId) {}
+
+        // False on a batch size of 0 (the batch loop would never advance)
+        bool train(const std::vector<ImgProc::Image>& shard, int epochs, int batchSize) {
+            auto* h = params.header();
+            auto* s = params.slot(id);
+            if (batchSize <= 0) {
+                std::cerr << "Error: AsyncWorker needs a batch size of at least 1." << std::endl;
+                h->workersDone.fetch_add(1, std::memory_order_release); // the server must not wait for us
+                return false;
+            }
+            float* pushed = params.slotGrads(id);
+            std::vector<float> snapshot(params.numParams());
+            GradientBuffer grads(replica);
+            GradientScratch scratch(replica);
+            std::vector<size_t> order(shard.size());
+            for (size_t i = 0; i < order.size(); i++) order[i] = i;
+            std::mt19937 rng(std::random_device{}() + id);
+
+            uint64_t version = pull(snapshot);
+            for (int e = 0; e < epochs; e++) {
+                std::shuffle(order.begin(), order.end(), rng);
+                for (size_t first = 0; first + batchSize <= order.size(); first += batchSize) {
+                    // 1. Start from the newest weights: a pull is one memcpy, far cheaper than
+                    //    the mini-batch, so staleness only comes from updates landing meanwhile
+                    if (h->version.load(std::memory_order_relaxed) != version) version = pull(snapshot);
+
+                    // 2. Local gradient
+                    grads.zero();
+                    float loss = 0.0f;
+                    for (int b = 0; b < batchSize; b++) {
+                        const auto& img = shard[order[first + b]];
+                        loss += accumulateGradients(replica, img.pixels.data(), img.target.data(), grads, scratch);
+                    }
+
+                    // 3. Push (wait for the server to have consumed the previous one)
+                    while (s->full.load(std::memory_order_acquire) != 0) std::this_thread::yield();
+                    std::copy(grads.data.begin(), grads.data.end(), pushed);
+                    s->samples = batchSize;
+                    s->baseVersion = version;
+                    s->loss = loss;
+                    s->full.store(1, std::memory_order_release);
+                }
+            }
+            while (s->full.load(std::memory_order_acquire) != 0) std::this_thread::yield();
+            h->workersDone.fetch_add(1, std::memory_order_release);
+            return true;
+        }
+
+    private:
+        uint64_t pull(std::vector<float>& snapshot) {
+            uint64_t version = params.readSnapshot(snapshot.data());
+            SharedParameters::unflatten(snapshot.data(), replica);
+            return version;
+        }
+    };
+}
@@ -0,0 +1,228 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <variant>
+#include <algorithm>
+#include <iostream>
+
+#include "network.h"
+#include "numa.h"
+
+namespace NN {
+
+    // Lock-free single-producer / single-consumer ring buffer.
+    // head and tail sit on separate cache lines so producer and consumer never false-share.
+    template <class T>
+    class SpscQueue {
+    public:
+        explicit SpscQueue(size_t capacity) {
+            size_t cap = 1;
+            while (cap < capacity) cap <<= 1;
+            slots.resize(cap);
+            mask = cap - 1;
+        }
+
+        bool tryPush(T&& value) {
+            const size_t t = tail.load(std::memory_order_relaxed);
+            if (t - head.load(std::memory_order_acquire) > mask) return false; // full
+            slots[t & mask] = std::move(value);
+            tail.store(t + 1, std::memory_order_release);
+            return true;
+        }
+
+        bool tryPop(T& out) {
+            const size_t h = head.load(std::memory_order_relaxed);
+            if (h == tail.load(std::memory_order_acquire)) return false; // empty
+            out = std::move(slots[h & mask]);
+            head.store(h + 1, std::memory_order_release);
+            return true;
+        }
+
+    private:
+        std::vector<T> slots;
+        size_t mask;
+        alignas(64) std::atomic<size_t> head{0}; // written by the consumer
+        alignas(64) std::atomic<size_t> tail{0}; // written by the producer
+    };
+
+    // Pipeline-parallel batch scoring. The network is cut into contiguous groups of layers
+    // (balanced by multiply-adds), each group runs on its own pinned core with its own copy of
+    // the weights, and micro-batches flow stage to stage through SpscQueues. Every core keeps
+    // touching the same weights, so they stay in its private cache.
+    //
+    //     PipelineInference pipe(net);
+    //     auto outputs = pipe.run(inputs);   // same results as net.predict() per input
+    class PipelineInference {
+    public:
+        struct MicroBatch {
+            int count = 0;           // samples in this batch, -1 = shut down
+            int width = 0;           // floats per sample
+            std::vector<float> data; // [count][width]
+        };
+
+        // stages = 0: one per layer, capped by the number of cores
+        explicit PipelineInference(const NeuralNetwork& net, int stages = 0, size_t queueDepth = 8) {
+            NumaTopology topo = NumaTopology::detect();
+            std::vector<int> cpus;
+            for (auto& node : topo.nodeCpus) cpus.insert(cpus.end(), node.begin(), node.end());
+
+            const int numLayers = static_cast<int>(net.layers.size());
+            if (stages <= 0) stages = std::min<int>(numLayers, static_cast<int>(cpus.size()));
+            stages = std::max(1, std::min(stages, numLayers));
+
+            auto groups = balance(net, stages);
+            for (int s = 0; s <= stages; s++) queues.push_back(std::make_unique<SpscQueue<MicroBatch>>(queueDepth));
+
+            for (int s = 0; s < stages; s++) {
+                const int first = groups[s];
+                const int last = groups[s + 1];
+                const int cpu = cpus[s % cpus.size()];
+                threads.emplace_back([this, &net, s, first, last, cpu] {
+                    pinThisThread(cpu);
+                    // The stage's own copy of its layers, first touched on its core
+                    std::vector<AnyLayer> layers(net.layers.begin() + first, net.layers.begin() + last);
+                    ready.fetch_add(1);
+                    stageLoop(s, layers);
+                });
+            }
+            // Don't return before every stage has copied its layers (net may go away after)
+            while (ready.load() < stages) std::this_thread::yield();
+        }
+
+        ~PipelineInference() {
+            MicroBatch stop;
+            stop.count = -1;
+            while (!queues.front()->tryPush(std::move(stop))) std::this_thread::yield();
+            for (auto& t : threads) t.join();
+        }
+
+        PipelineInference(const PipelineInference&) = delete;
+        PipelineInference& operator=(const PipelineInference&) = delete;
+
+        int numStages() const { return static_cast<int>(threads.size()); }
+
+        // Streams `inputs` through the pipeline in micro-batches, results in input order.
+        // The calling thread feeds the first queue and drains the last one.
+        std::vector<std::vector<float>> run(const std::vector<std::vector<float>>& inputs, int microBatchSize = 32) {
+            std::vector<std::vector<float>> outputs;
+            outputs.reserve(inputs.size());
+            if (inputs.empty()) return outputs;
+
+            const size_t width = inputs[0].size();
+            size_t next = 0;
+            MicroBatch pending;
+            bool havePending = false;
+
+            while (outputs.size() < inputs.size()) {
+                bool progress = false;
+
+                // 1. Feed
+                if (!havePending && next < inputs.size()) {
+                    pending.count = static_cast<int>(std::min<size_t>(microBatchSize, inputs.size() - next));
+                    pending.width = static_cast<int>(width);
+                    pending.data.resize(pending.count * width);
+                    for (int b = 0; b < pending.count; b++) {
+                        std::copy(inputs[next + b].begin(), inputs[next + b].end(), pending.data.begin() + b * width);
+                    }
+                    next += pending.count;
+                    havePending = true;
+                }
+                if (havePending && queues.front()->tryPush(std::move(pending))) {
+                    havePending = false;
+                    pending = MicroBatch();
+                    progress = true;
+                }
+
+                // 2. Drain
+                MicroBatch done;
+                while (queues.back()->tryPop(done)) {
+                    for (int b = 0; b < done.count; b++) {
+                        outputs.emplace_back(done.data.begin() + b * done.width, done.data.begin() + (b + 1) * done.width);
+                    }
+                    progress = true;
+                }
+                if (!progress) std::this_thread::yield();
+            }
+            return outputs;
+        }
+
+    private:
+        std::vector<std::unique_ptr<SpscQueue<MicroBatch>>> queues; // stages + 1
+        std::vector<std::thread> threads;
+        std::atomic<int> ready{0};
+
+        // Rough cost of one sample through a layer (multiply-adds)
+        static double cost(const AnyLayer& layer) {
+            if (auto* d = std::get_if<Layer>(&layer)) return static_cast<double>(d->numNodesIn) * d->numNodesOut;
+            if (auto* c = std::get_if<ConvLayer>(&layer)) {
+                return static_cast<double>(c->outChannels) * c->inChannels * c->kernelSize * c->kernelSize * c->outWidth * c->outHeight;
+            }
+            if (auto* p = std::get_if<PoolLayer>(&layer)) return p->inputSize();
+            if (auto* n = std::get_if<NormLayer>(&layer)) return n->size * 4.0;
+            return 1.0;
+        }
+
+        // Cut points so each stage gets about total / stages of the work. groups[s]..groups[s+1]
+        static std::vector<int> balance(const NeuralNetwork& net, int stages) {
+            const int n = static_cast<int>(net.layers.size());
+            double total = 0.0;
+            for (auto& l : net.layers) total += cost(l);
+
+            std::vector<int> cuts = {0};
+            double acc = 0.0;
+            for (int i = 0; i < n; i++) {
+                acc += cost(net.layers[i]);
+                const int stagesLeft = stages - static_cast<int>(cuts.size());
+                const int layersLeft = n - (i + 1);
+                bool full = acc >= total * cuts.size() / stages;
+                if (stagesLeft > 0 && (full || layersLeft == stagesLeft) && layersLeft >= stagesLeft) {
+                    cuts.push_back(i + 1);
+                }
+            }
+            cuts.push_back(n);
+            return cuts;
+        }
+
+        void stageLoop(int s, std::vector<AnyLayer>& layers) {
+            SpscQueue<MicroBatch>& in = *queues[s];
+            SpscQueue<MicroBatch>& out = *queues[s + 1];
+            int idle = 0;
+
+            while (true) {
+                MicroBatch batch;
+                if (!in.tryPop(batch)) {
+                    // Spin briefly, then back off so an idle pipeline doesn't burn the cores
+                    if (++idle < 1000) std::this_thread::yield();
+                    else std::this_thread::sleep_for(std::chrono::microseconds(50));
+                    continue;
+                }
+                idle = 0;
+
+                if (batch.count >= 0) {
+                    MicroBatch result;
+                    result.count = batch.count;
+                    for (int b = 0; b < batch.count; b++) {
+                        std::vector<float> x(batch.data.begin() + b * batch.width, batch.data.begin() + (b + 1) * batch.width);
+                        for (auto& layer : layers) {
+                            x = std::visit([&](const auto& l) { return l.infer(x); }, layer);
+                        }
+                        if (b == 0) {
+                            result.width = static_cast<int>(x.size());
+                            result.data.resize(static_cast<size_t>(batch.count) * result.width);
+                        }
+                        std::copy(x.begin(), x.end(), result.data.begin() + static_cast<size_t>(b) * result.width);
+                    }
+                    batch = std::move(result);
+                }
+
+                const bool stop = batch.count < 0;
+                while (!out.tryPush(std::move(batch))) std::this_thread::yield();
+                if (stop) return;
+            }
+        }
+    };
+}
@@ -0,0 +1,244 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace NN {
+
+    enum class PoolType { Max = 'm', Average = 'a' };
+
+    // 2D Pooling over [channel][y][x] inputs. No weights, so backPropagate only routes gradients.
+    //
+    // MEMORY: Max pooling remembers the winner of every window as a 1-byte offset
+    // (dy * poolSize + dx) instead of keeping the whole input or a mask around.
+    // The common 2x2 / stride 2 case has an SSE2 kernel that handles 4 windows at a time.
+    class PoolLayer {
+    public:
+        static constexpr char tag = 'p';
+
+        int channels;
+        int inWidth;
+        int inHeight;
+        int poolSize;
+        int stride;
+        int outWidth;
+        int outHeight;
+        PoolType poolType;
+
+        std::vector<uint8_t> lastArgmax; // One offset per output (Max only)
+
+        PoolLayer(int ch, int inW, int inH, int size, int str, PoolType type)
+        : channels(ch), inWidth(inW), inHeight(inH), poolSize(size), stride(str),
+          outWidth(0), outHeight(0), poolType(type) {
+            // The window offset (dy * poolSize + dx) has to fit in a byte
+            if (size <= 0 || size > 16 || str <= 0 || size > inW || size > inH) {
+                throw std::invalid_argument("PoolLayer: window must be 1-16 and fit the input, stride must be positive");
+            }
+            outWidth = (inW - size) / str + 1;
+            outHeight = (inH - size) / str + 1;
+        }
+
+        int inputSize() const { return channels * inWidth * inHeight; }
+        int outputSize() const { return channels * outWidth * outHeight; }
+
+        // 1. FORWARD PASS
+        std::vector<float> calculateOutput(const std::vector<float>& inputs) {
+            if (poolType == PoolType::Max) lastArgmax.resize(outputSize());
+            return pool(inputs, lastArgmax);
+        }
+
+        // Inference only: argmax goes to a throwaway buffer, so many threads may call it at once
+        std::vector<float> infer(const std::vector<float>& inputs) const {
+            std::vector<uint8_t> argmax(poolType == PoolType::Max ? outputSize() : 0);
+            return pool(inputs, argmax);
+        }
+
+        // 2. BACKWARD PASS
+        // Returns: Gradients for the PREVIOUS layer. Nothing to learn here.
+        std::vector<float> backPropagate(const std::vector<float>& outputGradients, float /*learningRate*/, float /*l1*/ = 0.0f) {
+            std::vector<float> inputGradients(inputSize(), 0.0f);
+            const int inPlane = inWidth * inHeight;
+            const int outPlane = outWidth * outHeight;
+            const float avgScale = 1.0f / (poolSize * poolSize);
+
+            for (int c = 0; c < channels; c++) {
+                float* inGrad = &inputGradients[c * inPlane];
+                for (int oy = 0; oy < outHeight; oy++) {
+                    for (int ox = 0; ox < outWidth; ox++) {
+                        int o = c * outPlane + oy * outWidth + ox;
+                        float* base = &inGrad[(oy * stride) * inWidth + ox * stride];
+
+                        if (poolType == PoolType::Max) {
+                            // Only the winner of the window gets the gradient
+                            int offset = lastArgmax[o];
+                            base[(offset / poolSize) * inWidth + (offset % poolSize)] += outputGradients[o];
+                        } else {
+                            float g = outputGradients[o] * avgScale;
+                            for (int dy = 0; dy < poolSize; dy++) {
+                                for (int dx = 0; dx < poolSize; dx++) {
+                                    base[dy * inWidth + dx] += g;
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+            return inputGradients;
+        }
+
+        void write(std::ostream& file) const {
+            file.write((char*)&channels, sizeof(int));
+            file.write((char*)&inWidth, sizeof(int));
+            file.write((char*)&inHeight, sizeof(int));
+            file.write((char*)&poolSize, sizeof(int));
+            file.write((char*)&stride, sizeof(int));
+            file.write((char*)&poolType, sizeof(PoolType));
+        }
+
+        static PoolLayer read(std::istream& file) {
+            int ch, inW, inH, size, str;
+            PoolType type;
+            file.read((char*)&ch, sizeof(int));
+            file.read((char*)&inW, sizeof(int));
+            file.read((char*)&inH, sizeof(int));
+            file.read((char*)&size, sizeof(int));
+            file.read((char*)&str, sizeof(int));
+            file.read((char*)&type, sizeof(PoolType));
+            return PoolLayer(ch, inW, inH, size, str, type);
+        }
+
+    private:
+        // Shared by calculateOutput (argmax kept for backprop) and infer (argmax thrown away)
+        std::vector<float> pool(const std::vector<float>& inputs, std::vector<uint8_t>& argmax) const {
+            std::vector<float> outputs(outputSize());
+            const int inPlane = inWidth * inHeight;
+            const int outPlane = outWidth * outHeight;
+            const bool fast2x2 = (poolSize == 2 && stride == 2);
+
+            for (int c = 0; c < channels; c++) {
+                const float* in = &inputs[c * inPlane];
+                float* out = &outputs[c * outPlane];
+                uint8_t* arg = (poolType == PoolType::Max) ? &argmax[c * outPlane] : nullptr;
+
+                for (int oy = 0; oy < outHeight; oy++) {
+                    float* outRow = &out[oy * outWidth];
+                    uint8_t* argRow = arg ? &arg[oy * outWidth] : nullptr;
+
+                    if (fast2x2) {
+                        const float* row0 = &in[(oy * 2) * inWidth];
+                        const float* row1 = row0 + inWidth;
+                        if (poolType == PoolType::Max) maxPool2x2Row(row0, row1, outRow, argRow, outWidth);
+                        else averagePool2x2Row(row0, row1, outRow, outWidth);
+                        continue;
+                    }
+
+                    for (int ox = 0; ox < outWidth; ox++) {
+                        const float* base = &in[(oy * stride) * inWidth + ox * stride];
+                        if (poolType == PoolType::Max) {
+                            float best = base[0];
+                            uint8_t bestOffset = 0;
+                            for (int dy = 0; dy < poolSize; dy++) {
+                                for (int dx = 0; dx < poolSize; dx++) {
+                                    float v = base[dy * inWidth + dx];
+                                    if (v > best) {
+                                        best = v;
+                                        bestOffset = static_cast<uint8_t>(dy * poolSize + dx);
+                                    }
+                                }
+                            }
+                            outRow[ox] = best;
+                            argRow[ox] = bestOffset;
+                        } else {
+                            float sum = 0.0f;
+                            for (int dy = 0; dy < poolSize; dy++) {
+                                for (int dx = 0; dx < poolSize; dx++) {
+                                    sum += base[dy * inWidth + dx];
+                                }
+                            }
+                            outRow[ox] = sum / (poolSize * poolSize);
+                        }
+                    }
+                }
+            }
+            return outputs;
+        }
+
+        // 2x2 / stride 2 max over one output row. Reduction order (rows first, then columns,
+        // ties keep the earlier one) is the same in the SIMD and scalar code, so the chosen
+        // argmax does not depend on whether SSE2 is available.
+        static void maxPool2x2Row(const float* row0, const float* row1, float* out, uint8_t* arg, int outW) {
+            int ox = 0;
+#if defined(__SSE2__)
+            const __m128i two = _mm_set1_epi32(2);
+            const __m128i one = _mm_set1_epi32(1);
+            for (; ox + 4 <= outW; ox += 4) {
+                __m128 r0a = _mm_loadu_ps(row0 + ox * 2);
+                __m128 r0b = _mm_loadu_ps(row0 + ox * 2 + 4);
+                __m128 r1a = _mm_loadu_ps(row1 + ox * 2);
+                __m128 r1b = _mm_loadu_ps(row1 + ox * 2 + 4);
+
+                // 1. Vertical: best of the two rows, remember if the bottom one won
+                __m128 va = _mm_max_ps(r0a, r1a);
+                __m128 vb = _mm_max_ps(r0b, r1b);
+                __m128 sa = _mm_cmpgt_ps(r1a, r0a);
+                __m128 sb = _mm_cmpgt_ps(r1b, r0b);
+
+                // 2. Horizontal: split even/odd columns and compare
+                __m128 even = _mm_shuffle_ps(va, vb, _MM_SHUFFLE(2, 0, 2, 0));
+                __m128 odd = _mm_shuffle_ps(va, vb, _MM_SHUFFLE(3, 1, 3, 1));
+                __m128i selEven = _mm_castps_si128(_mm_shuffle_ps(sa, sb, _MM_SHUFFLE(2, 0, 2, 0)));
+                __m128i selOdd = _mm_castps_si128(_mm_shuffle_ps(sa, sb, _MM_SHUFFLE(3, 1, 3, 1)));
+                __m128i pickOdd = _mm_castps_si128(_mm_cmpgt_ps(odd, even));
+
+                _mm_storeu_ps(out + ox, _mm_max_ps(even, odd));
+
+                // 3. offset = dy * 2 + dx
+                __m128i offEven = _mm_and_si128(selEven, two);
+                __m128i offOdd = _mm_add_epi32(_mm_and_si128(selOdd, two), one);
+                __m128i offset = _mm_or_si128(_mm_and_si128(pickOdd, offOdd), _mm_andnot_si128(pickOdd, offEven));
+                __m128i packed = _mm_packus_epi16(_mm_packs_epi32(offset, offset), _mm_setzero_si128());
+                int bytes = _mm_cvtsi128_si32(packed);
+                std::memcpy(arg + ox, &bytes, 4);
+            }
+#endif
+            for (; ox < outW; ox++) {
+                const float* a = row0 + ox * 2;
+                const float* b = row1 + ox * 2;
+                float even = std::max(a[0], b[0]);
+                float odd = std::max(a[1], b[1]);
+                uint8_t offEven = (b[0] > a[0]) ? 2 : 0;
+                uint8_t offOdd = (b[1] > a[1]) ? 3 : 1;
+                bool pickOdd = odd > even;
+                out[ox] = pickOdd ? odd : even;
+                arg[ox] = pickOdd ? offOdd : offEven;
+            }
+        }
+
+        static void averagePool2x2Row(const float* row0, const float* row1, float* out, int outW) {
+            int ox = 0;
+#if defined(__SSE2__)
+            const __m128 quarter = _mm_set1_ps(0.25f);
+            for (; ox + 4 <= outW; ox += 4) {
+                __m128 va = _mm_add_ps(_mm_loadu_ps(row0 + ox * 2), _mm_loadu_ps(row1 + ox * 2));
+                __m128 vb = _mm_add_ps(_mm_loadu_ps(row0 + ox * 2 + 4), _mm_loadu_ps(row1 + ox * 2 + 4));
+                __m128 even = _mm_shuffle_ps(va, vb, _MM_SHUFFLE(2, 0, 2, 0));
+                __m128 odd = _mm_shuffle_ps(va, vb, _MM_SHUFFLE(3, 1, 3, 1));
+                _mm_storeu_ps(out + ox, _mm_mul_ps(_mm_add_ps(even, odd), quarter));
+            }
+#endif
+            for (; ox < outW; ox++) {
+                const float* a = row0 + ox * 2;
+                const float* b = row1 + ox * 2;
+                out[ox] = ((a[0] + b[0]) + (a[1] + b[1])) * 0.25f;
+            }
+        }
+    };
+}
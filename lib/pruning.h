@@ -0,0 +1,187 @@
+#pragma once
+
+#include <vector>
+#include <mutex>
+#include <random>
+#include <numeric>
+#include <algorithm>
+#include <cmath>
+
+#include "network.h"
+#include "thread_pool.h"
+#include "image_processing.h"
+
+namespace NN {
+
+    // Activation statistics of one prunable dense layer over the calibration samples
+    struct NeuronStats {
+        size_t layer = 0;          // index in NeuralNetwork::layers
+        std::vector<float> mean;   // mean activation per neuron
+        std::vector<float> score;  // contribution: stddev(activation) * |outgoing weights|
+    };
+
+    // STRUCTURED PRUNING: removes whole hidden neurons, so the result is a smaller DENSE
+    // network that runs on the normal kernels (no masks, no sparse formats).
+    //
+    // A hidden neuron j of dense layer L only reaches the output through row j of the next
+    // dense layer's weights. Its contribution is how much it varies (stddev of its activation
+    // over the calibration set) times how strongly it is read (L2 norm of that row). A neuron
+    // that barely varies is close to a constant: on removal its mean activation times its
+    // outgoing weights is folded into the next layer's biases, so what is left is the part
+    // that actually carried information.
+    //
+    // Only a dense Layer directly followed by another dense Layer is pruned; the last layer
+    // (the classes) and anything next to conv/pool/norm/dropout layers are kept as they are.
+    class NeuronPruner {
+    public:
+        float keepRatio = 0.5f;           // fraction of every hidden layer to keep
+        int minKeep = 1;                  // never shrink a layer below this
+        size_t calibrationSamples = 2000; // samples used to measure activations (0 = all)
+        int fineTuneEpochs = 0;           // short retraining after pruning (0 = none)
+        size_t fineTuneSamples = 0;       // samples per fine-tuning epoch (0 = all)
+        float learningRate = 0.01f;
+
+        // analyze -> prune -> fineTune
+        NeuralNetwork run(const NeuralNetwork& net, const std::vector<ImgProc::Image>& data) const {
+            NeuralNetwork pruned = prune(net, analyze(net, data));
+            fineTune(pruned, data);
+            return pruned;
+        }
+
+        static bool prunable(const NeuralNetwork& net, size_t i) {
+            return i + 1 < net.layers.size() &&
+                   std::holds_alternative<Layer>(net.layers[i]) && std::holds_alternative<Layer>(net.layers[i + 1]);
+        }
+
+        // Forward passes over the calibration samples (in parallel, the network is only read)
+        std::vector<NeuronStats> analyze(const NeuralNetwork& net, const std::vector<ImgProc::Image>& data) const {
+            std::vector<size_t> targets;
+            for (size_t i = 0; i < net.layers.size(); i++) {
+                if (prunable(net, i)) targets.push_back(i);
+            }
+            const size_t count = calibrationSamples ? std::min(calibrationSamples, data.size()) : data.size();
+
+            // 1. Sum and sum of squares of every neuron's activation
+            std::vector<std::vector<double>> sum(targets.size()), sumSq(targets.size());
+            for (size_t t = 0; t < targets.size(); t++) {
+                const int n = std::get<Layer>(net.layers[targets[t]]).numNodesOut;
+                sum[t].assign(n, 0.0);
+                sumSq[t].assign(n, 0.0);
+            }
+            std::mutex mutex;
+            ThreadPool::instance().parallelFor(0, count, 256, [&](size_t lo, size_t hi) {
+                auto localSum = sum, localSq = sumSq;
+                for (size_t s = lo; s < hi; s++) {
+                    std::vector<float> x = data[s].pixels;
+                    for (size_t i = 0, t = 0; i < net.layers.size() && t < targets.size(); i++) {
+                        x = std::visit([&](const auto& l) { return l.infer(x); }, net.layers[i]);
+                        if (i != targets[t]) continue;
+                        for (size_t j = 0; j < x.size(); j++) {
+                            localSum[t][j] += x[j];
+                            localSq[t][j] += double(x[j]) * x[j];
+                        }
+                        t++;
+                    }
+                }
+                std::lock_guard<std::mutex> lock(mutex);
+                for (size_t t = 0; t < targets.size(); t++) {
+                    for (size_t j = 0; j < sum[t].size(); j++) {
+                        sum[t][j] += localSum[t][j];
+                        sumSq[t][j] += localSq[t][j];
+                    }
+                }
+            });
+
+            // 2. Score = stddev * norm of the outgoing weight row
+            std::vector<NeuronStats> stats(targets.size());
+            for (size_t t = 0; t < targets.size(); t++) {
+                const Layer& next = std::get<Layer>(net.layers[targets[t] + 1]);
+                const size_t n = sum[t].size();
+                stats[t].layer = targets[t];
+                stats[t].mean.resize(n);
+                stats[t].score.resize(n);
+                for (size_t j = 0; j < n; j++) {
+                    const double mean = count ? sum[t][j] / count : 0.0;
+                    const double var = count ? std::max(0.0, sumSq[t][j] / count - mean * mean) : 0.0;
+                    double norm = 0.0;
+                    for (int k = 0; k < next.numNodesOut; k++) {
+                        const float w = next.weights[j * next.numNodesOut + k];
+                        norm += double(w) * w;
+                    }
+                    stats[t].mean[j] = static_cast<float>(mean);
+                    stats[t].score[j] = static_cast<float>(std::sqrt(var) * std::sqrt(norm));
+                }
+            }
+            return stats;
+        }
+
+        // Indices of the neurons to keep (highest scores), in their original order
+        std::vector<int> selectNeurons(const NeuronStats& s) const {
+            const int n = static_cast<int>(s.score.size());
+            int keep = static_cast<int>(std::ceil(keepRatio * n));
+            keep = std::clamp(keep, std::min(minKeep, n), n);
+
+            std::vector<int> order(n);
+            std::iota(order.begin(), order.end(), 0);
+            std::nth_element(order.begin(), order.begin() + keep, order.end(),
+                             [&](int a, int b) { return s.score[a] > s.score[b]; });
+            order.resize(keep);
+            std::sort(order.begin(), order.end());
+            return order;
+        }
+
+        // Copy of `net` with the low-scoring neurons removed from every analysed layer
+        NeuralNetwork prune(const NeuralNetwork& net, const std::vector<NeuronStats>& stats) const {
+            NeuralNetwork result = net;
+            for (const NeuronStats& s : stats) {
+                if (!prunable(result, s.layer)) continue;
+                const Layer& cur = std::get<Layer>(result.layers[s.layer]);
+                const Layer& next = std::get<Layer>(result.layers[s.layer + 1]);
+                if (static_cast<size_t>(cur.numNodesOut) != s.score.size()) continue; // stats of another network
+                const std::vector<int> keep = selectNeurons(s);
+                const int nIn = cur.numNodesIn, nOld = cur.numNodesOut, nNew = static_cast<int>(keep.size());
+                const int nNext = next.numNodesOut;
+
+                // 1. Layer L: keep columns `keep` of W[in][out] and their biases
+                Layer smaller(nIn, nNew, cur.actType);
+                for (int i = 0; i < nIn; i++) {
+                    for (int c = 0; c < nNew; c++) smaller.weights[i * nNew + c] = cur.weights[i * nOld + keep[c]];
+                }
+                for (int c = 0; c < nNew; c++) smaller.biases[c] = cur.biases[keep[c]];
+
+                // 2. Layer L+1: keep rows `keep`; the removed rows' mean contribution goes to the biases
+                Layer narrower(nNew, nNext, next.actType);
+                narrower.biases = next.biases;
+                std::vector<char> kept(nOld, 0);
+                for (int c = 0; c < nNew; c++) {
+                    kept[keep[c]] = 1;
+                    std::copy_n(&next.weights[keep[c] * nNext], nNext, &narrower.weights[c * nNext]);
+                }
+                for (int j = 0; j < nOld; j++) {
+                    if (kept[j]) continue;
+                    for (int k = 0; k < nNext; k++) narrower.biases[k] += s.mean[j] * next.weights[j * nNext + k];
+                }
+
+                result.layers[s.layer] = std::move(smaller);
+                result.layers[s.layer + 1] = std::move(narrower);
+            }
+            return result;
+        }
+
+        // A few plain SGD epochs so the remaining neurons take over from the removed ones
+        void fineTune(NeuralNetwork& net, const std::vector<ImgProc::Image>& data) const {
+            if (fineTuneEpochs <= 0 || data.empty()) return;
+            std::vector<size_t> order(data.size());
+            std::iota(order.begin(), order.end(), 0);
+            std::mt19937 gen(std::random_device{}());
+            const size_t count = fineTuneSamples ? std::min(fineTuneSamples, data.size()) : data.size();
+
+            for (int epoch = 0; epoch < fineTuneEpochs; epoch++) {
+                std::shuffle(order.begin(), order.end(), gen);
+                for (size_t s = 0; s < count; s++) {
+                    net.train(data[order[s]].pixels, data[order[s]].target, learningRate);
+                }
+            }
+        }
+    };
+}
@@ -0,0 +1,308 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <filesystem>
+#include <unordered_map>
+#include <iostream>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+
+#include "mapped_file.h"
+#include "async_reader.h"
+
+namespace NN {
+
+    // SHARDED DATASET: a directory of shard files plus one index.
+    //
+    //     <dir>/index.bin          IndexHeader, then one IndexEntry per sample
+    //     <dir>/shard-00000.bin    "NNSH", then the raw bytes of its samples back to back
+    //     <dir>/shard-00001.bin    ...
+    //
+    // The index is fixed-width, so sample i is found in O(1) (entry i of an mmap, no parse
+    // and no load: a 100M-sample index is paged in on demand). Shards keep single files at a
+    // manageable size and let several readers stream from different files in parallel.
+    struct IndexHeader {
+        char magic[4];       // "NNX1"
+        uint32_t version;    // 1
+        uint64_t samples;
+        uint32_t shards;
+        uint32_t rows;       // sample shape, e.g. 28 x 28 (bytes per sample = rows * cols)
+        uint32_t cols;
+        uint32_t reserved;
+    };
+
+    struct IndexEntry {
+        uint64_t offset;     // byte offset inside its shard
+        uint32_t shard;
+        uint32_t length;     // bytes
+        int32_t label;
+        uint32_t reserved;
+    };
+
+    static_assert(sizeof(IndexHeader) == 32 && sizeof(IndexEntry) == 24, "index layout is part of the file format");
+
+    inline std::string shardFileName(uint32_t shard) {
+        char name[32];
+        std::snprintf(name, sizeof(name), "shard-%05u.bin", shard);
+        return name;
+    }
+
+    // CHEAP GLOBAL SHUFFLE: a seeded bijection on [0, n) instead of a shuffled id array, so a
+    // fresh order over hundreds of millions of samples costs no memory and no setup time.
+    // A 4-round Feistel network permutes the next power of four >= n; values that land
+    // outside [0, n) are encrypted again (cycle walking, < 4 rounds on average).
+    class RandomPermutation {
+    public:
+        RandomPermutation(uint64_t count, uint64_t seed) : n(count) {
+            int bits = 2;
+            while (bits < 64 && (uint64_t(1) << bits) < n) bits += 2;
+            halfBits = bits / 2;
+            halfMask = (uint64_t(1) << halfBits) - 1;
+            for (auto& k : keys) k = mix(seed += 0x9E3779B97F4A7C15ull);
+        }
+
+        uint64_t operator[](uint64_t i) const {
+            uint64_t x = i;
+            do {
+                x = encrypt(x);
+            } while (x >= n);
+            return x;
+        }
+
+        uint64_t size() const { return n; }
+
+    private:
+        uint64_t n;
+        int halfBits;
+        uint64_t halfMask;
+        uint64_t keys[4];
+
+        static uint64_t mix(uint64_t z) {
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+            return z ^ (z >> 31);
+        }
+
+        uint64_t encrypt(uint64_t x) const {
+            uint64_t left = x >> halfBits, right = x & halfMask;
+            for (uint64_t k : keys) {
+                uint64_t next = left ^ (mix(right ^ k) & halfMask);
+                left = right;
+                right = next;
+            }
+            return (left << halfBits) | right;
+        }
+    };
+
+    // Streams samples into shards; the index is written next to them and renamed into place
+    // by finish(), so a half-converted directory never looks complete.
+    class ShardWriter {
+    public:
+        ShardWriter(const std::string& directory, uint32_t rows, uint32_t cols, uint64_t samplesPerShard = 1 << 20)
+        : dir(directory), perShard(samplesPerShard < 1 ? 1 : samplesPerShard) {
+            std::memcpy(header.magic, "NNX1", 4);
+            header.version = 1;
+            header.samples = 0;
+            header.shards = 0;
+            header.rows = rows;
+            header.cols = cols;
+            header.reserved = 0;
+
+            std::error_code ec;
+            std::filesystem::create_directories(dir, ec);
+            index.open(dir + "/index.bin.tmp", std::ios::binary | std::ios::trunc);
+            if (!index.is_open()) {
+                std::cerr << "Error: Could not write to " << dir << std::endl;
+                failed = true;
+                return;
+            }
+            index.write(reinterpret_cast<const char*>(&header), sizeof(header)); // patched in finish()
+        }
+
+        bool add(const uint8_t* data, uint32_t length, int32_t label) {
+            if (failed || finished) return false;
+            if (!shard.is_open() || inShard == perShard) {
+                if (!nextShard()) return false;
+            }
+            IndexEntry e{shardOffset, header.shards - 1, length, label, 0};
+            shard.write(reinterpret_cast<const char*>(data), length);
+            index.write(reinterpret_cast<const char*>(&e), sizeof(e));
+            shardOffset += length;
+            inShard++;
+            header.samples++;
+            if (!shard || !index) {
+                std::cerr << "Error: Writing the dataset failed (disk full?)" << std::endl;
+                failed = true;
+            }
+            return !failed;
+        }
+
+        bool finish() {
+            if (failed || finished) return false;
+            finished = true;
+            // The close flushes the last shard's buffered bytes, so this is where a full disk shows
+            if (!closeShard()) {
+                index.close();
+                std::remove((dir + "/index.bin.tmp").c_str());
+                return false;
+            }
+            index.seekp(0);
+            index.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            index.close();
+            if (!index || std::rename((dir + "/index.bin.tmp").c_str(), (dir + "/index.bin").c_str()) != 0) {
+                std::cerr << "Error: Could not write " << dir << "/index.bin" << std::endl;
+                return false;
+            }
+            std::cout << "Wrote " << header.samples << " samples in " << header.shards << " shards to " << dir << std::endl;
+            return true;
+        }
+
+        uint64_t samples() const { return header.samples; }
+
+    private:
+        std::string dir;
+        uint64_t perShard;
+        IndexHeader header;
+        std::ofstream index;
+        std::ofstream shard;
+        uint64_t shardOffset = 0;
+        uint64_t inShard = 0;
+        bool failed = false;
+        bool finished = false;
+
+        bool closeShard() {
+            if (!shard.is_open()) return true;
+            shard.close();
+            if (!shard) {
+                std::cerr << "Error: Writing shard " << header.shards - 1 << " in " << dir << " failed (disk full?)" << std::endl;
+                failed = true;
+                return false;
+            }
+            return true;
+        }
+
+        bool nextShard() {
+            if (!closeShard()) return false;
+            shard.open(dir + "/" + shardFileName(header.shards), std::ios::binary | std::ios::trunc);
+            if (!shard.is_open()) {
+                std::cerr << "Error: Could not create shard " << header.shards << " in " << dir << std::endl;
+                failed = true;
+                return false;
+            }
+            shard.write("NNSH", 4);
+            shardOffset = 4;
+            inShard = 0;
+            header.shards++;
+            return true;
+        }
+    };
+
+    // Read side. The dataset itself is immutable and can be shared by any number of threads;
+    // each thread gathers through its own Reader.
+    class ShardedDataset {
+    public:
+        bool open(const std::string& directory) {
+            dir = directory;
+            if (!index.open(dir + "/index.bin")) return false;
+            if (index.size() < sizeof(IndexHeader)) {
+                std::cerr << "Error: " << dir << "/index.bin is truncated." << std::endl;
+                index.close();
+                return false;
+            }
+            std::memcpy(&header, index.data(), sizeof(header));
+            if (std::memcmp(header.magic, "NNX1", 4) != 0 || header.version != 1 ||
+                index.size() != sizeof(IndexHeader) + header.samples * sizeof(IndexEntry)) {
+                std::cerr << "Error: " << dir << "/index.bin is not a valid dataset index." << std::endl;
+                index.close();
+                return false;
+            }
+            entries = reinterpret_cast<const IndexEntry*>(index.data() + sizeof(IndexHeader));
+            return true;
+        }
+
+        bool isOpen() const { return index.isOpen(); }
+        uint64_t size() const { return header.samples; }
+        uint32_t shards() const { return header.shards; }
+        uint32_t rows() const { return header.rows; }
+        uint32_t cols() const { return header.cols; }
+        uint32_t sampleBytes() const { return header.rows * header.cols; }
+        const std::string& directory() const { return dir; }
+
+        // O(1): entry i of the mapped index
+        const IndexEntry& entry(uint64_t i) const { return entries[i]; }
+        int label(uint64_t i) const { return entries[i].label; }
+
+        std::string shardPath(uint32_t shard) const { return dir + "/" + shardFileName(shard); }
+
+        // Gathers samples by id with batched async reads across shards. Not thread-safe:
+        // one Reader per thread.
+        class Reader {
+        public:
+            static constexpr size_t maxOpenShards = 256; // beyond that, start over (fd limits)
+
+            explicit Reader(const ShardedDataset& dataset, bool direct = false)
+            : data(dataset), directIo(direct) {}
+
+            // Sample ids[k] goes to pixels[k * sampleBytes()], its label to labels[k].
+            // Every sample must be sampleBytes() long.
+            bool gather(const uint64_t* ids, size_t count, uint8_t* pixels, int* labels) {
+                const uint32_t bytes = data.sampleBytes();
+                requests.clear();
+                pendingOk = true;
+                for (size_t k = 0; k < count; k++) {
+                    if (ids[k] >= data.size()) {
+                        std::cerr << "Error: sample " << ids[k] << " is out of range." << std::endl;
+                        return false;
+                    }
+                    const IndexEntry& e = data.entry(ids[k]);
+                    if (e.length != bytes) {
+                        std::cerr << "Error: sample " << ids[k] << " has " << e.length << " bytes, expected " << bytes << std::endl;
+                        return false;
+                    }
+                    int file = fileFor(e.shard);
+                    if (file < 0) return false;
+                    requests.push_back({e.offset, e.length, pixels + k * bytes, static_cast<uint32_t>(file)});
+                    labels[k] = e.label;
+                }
+                return reader.read(requests) && pendingOk;
+            }
+
+        private:
+            const ShardedDataset& data;
+            bool directIo;
+            bool pendingOk = true;
+            AsyncReader reader;
+            std::unordered_map<uint32_t, int> openShards; // shard -> file index in `reader`
+            std::vector<ReadRequest> requests;
+
+            int fileFor(uint32_t shard) {
+                auto it = openShards.find(shard);
+                if (it != openShards.end()) return it->second;
+                if (openShards.size() >= maxOpenShards) {
+                    // Requests built so far refer to the old file indices: read them first
+                    if (!requests.empty()) flushPending();
+                    reader.close();
+                    openShards.clear();
+                }
+                int file = reader.addFile(data.shardPath(shard), directIo);
+                if (file >= 0) openShards[shard] = file;
+                return file;
+            }
+
+            // Reads what was queued so far so the file table can be reset
+            void flushPending() {
+                pendingOk = reader.read(requests) && pendingOk;
+                requests.clear();
+            }
+        };
+
+    private:
+        std::string dir;
+        MappedFile index;
+        IndexHeader header{};
+        const IndexEntry* entries = nullptr;
+    };
+}
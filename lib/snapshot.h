@@ -0,0 +1,151 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <cstdint>
+
+namespace NN {
+
+    // Read-copy-update cell with EPOCH-BASED RECLAMATION.
+    //
+    // A writer publishes a new immutable version with one atomic pointer swap; readers load
+    // the pointer and use it for as long as they hold the ReadGuard. Readers never lock and
+    // never see a half-written (torn) value: a version is fully built before it is published
+    // and never written again while any reader can still reach it.
+    //
+    // EPOCHS: a reader announces the global epoch in a free slot before loading the pointer.
+    // A retired version is tagged with the epoch that followed its replacement and is only
+    // reclaimed once no slot announces an older epoch. Reclaimed versions are RECYCLED by the
+    // next publish (copy-assign into existing buffers), so steady-state publishing is
+    // double-buffered and allocation-free.
+    //
+    //     RcuCell<NeuralNetwork> weights(net);
+    //     { auto snap = weights.read(); snap->predict(x); }   // any thread
+    //     weights.publish(trainingCopy);                       // the trainer
+    template <class T>
+    class RcuCell {
+    public:
+        static constexpr int maxReaders = 128; // concurrent ReadGuards
+
+        class ReadGuard {
+        public:
+            ReadGuard(ReadGuard&& other) noexcept : slot(other.slot), ptr(other.ptr) { other.slot = nullptr; }
+            ReadGuard(const ReadGuard&) = delete;
+            ReadGuard& operator=(const ReadGuard&) = delete;
+            ReadGuard& operator=(ReadGuard&&) = delete;
+            ~ReadGuard() {
+                if (slot) slot->store(0, std::memory_order_release);
+            }
+
+            const T& operator*() const { return *ptr; }
+            const T* operator->() const { return ptr; }
+            const T* get() const { return ptr; }
+
+        private:
+            friend class RcuCell;
+            ReadGuard(std::atomic<uint64_t>* s, const T* p) : slot(s), ptr(p) {}
+            std::atomic<uint64_t>* slot;
+            const T* ptr;
+        };
+
+        explicit RcuCell(const T& initial) : current(new T(initial)) {}
+
+        ~RcuCell() {
+            // No reader may outlive the cell
+            delete current.load();
+            for (auto& r : retired) delete r.value;
+            for (auto* f : freeList) delete f;
+        }
+
+        RcuCell(const RcuCell&) = delete;
+        RcuCell& operator=(const RcuCell&) = delete;
+
+        // Lock-free: one CAS to claim a slot, one pointer load
+        ReadGuard read() const {
+            const uint64_t epoch = globalEpoch.load(std::memory_order_seq_cst);
+            size_t start = std::hash<std::thread::id>()(std::this_thread::get_id());
+            for (;;) {
+                for (int k = 0; k < maxReaders; k++) {
+                    auto& slot = slots[(start + k) % maxReaders].epoch;
+                    uint64_t expected = 0;
+                    if (slot.load(std::memory_order_relaxed) == 0 &&
+                        slot.compare_exchange_strong(expected, epoch, std::memory_order_seq_cst)) {
+                        return ReadGuard(&slot, current.load(std::memory_order_seq_cst));
+                    }
+                }
+                std::this_thread::yield(); // more than maxReaders readers at once
+            }
+        }
+
+        // Copies `value` into a recycled (or new) block and swaps it in
+        void publish(const T& value) {
+            std::lock_guard<std::mutex> lock(writerMutex); // writers only, readers never see it
+            T* next = recycled();
+            if (next) *next = value;
+            else next = new T(value);
+            swapIn(next);
+        }
+
+        // Same, moving `value` in (e.g. a model that was just loaded)
+        void publish(T&& value) {
+            std::lock_guard<std::mutex> lock(writerMutex);
+            T* next = recycled();
+            if (next) *next = std::move(value);
+            else next = new T(std::move(value));
+            swapIn(next);
+        }
+
+        // Number of publishes so far
+        uint64_t versions() const { return version.load(std::memory_order_relaxed); }
+
+    private:
+        struct alignas(64) Slot {
+            std::atomic<uint64_t> epoch{0}; // 0 = free, otherwise the epoch its reader started in
+        };
+        struct Retired {
+            T* value;
+            uint64_t epoch; // readers that announced an epoch >= this can't hold it
+        };
+
+        std::atomic<T*> current;
+        std::atomic<uint64_t> globalEpoch{1};
+        std::atomic<uint64_t> version{0};
+        mutable Slot slots[maxReaders];
+
+        std::mutex writerMutex;
+        std::vector<Retired> retired;
+        std::vector<T*> freeList;
+
+        T* recycled() {
+            if (freeList.empty()) return nullptr;
+            T* next = freeList.back();
+            freeList.pop_back();
+            return next;
+        }
+
+        void swapIn(T* next) {
+            T* old = current.exchange(next, std::memory_order_seq_cst);
+            const uint64_t after = globalEpoch.fetch_add(1, std::memory_order_seq_cst) + 1;
+            retired.push_back({old, after});
+            version.fetch_add(1, std::memory_order_relaxed);
+            reclaim();
+        }
+
+        void reclaim() {
+            uint64_t oldest = UINT64_MAX;
+            for (auto& s : slots) {
+                uint64_t e = s.epoch.load(std::memory_order_seq_cst);
+                if (e != 0 && e < oldest) oldest = e;
+            }
+            size_t kept = 0;
+            for (auto& r : retired) {
+                if (r.epoch <= oldest) freeList.push_back(r.value);
+                else retired[kept++] = r;
+            }
+            retired.resize(kept);
+        }
+    };
+}
@@ -0,0 +1,172 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <random>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+
+#include "network.h"
+#include "evaluator.h"
+#include "thread_pool.h"
+#include "image_processing.h"
+
+namespace NN {
+
+    struct SweepConfig {
+        float learningRate = 0.05f;
+        int hiddenSize = 64;
+        bool augment = false; // train on a translated / scaled copy too, like main.cpp
+
+        std::string name() const {
+            std::ostringstream ss;
+            ss << "lr=" << learningRate << " hidden=" << hiddenSize << " aug=" << (augment ? "on" : "off");
+            return ss.str();
+        }
+    };
+
+    // One configuration being trained. Survivors RESUME from where they stopped at the
+    // next rung instead of starting over.
+    struct Trial {
+        SweepConfig config;
+        NeuralNetwork net;
+        std::mt19937 rng;
+        std::vector<size_t> order;     // private shuffle of the shared dataset
+        size_t cursor = 0;
+        size_t samplesSeen = 0;
+        std::vector<float> accuracies; // validation accuracy after each rung survived
+        bool alive = true;
+
+        Trial(const SweepConfig& c, size_t datasetSize, unsigned seed)
+        : config(c), net({784, c.hiddenSize, 10}), rng(seed), order(datasetSize) {
+            for (size_t i = 0; i < order.size(); i++) order[i] = i;
+            std::shuffle(order.begin(), order.end(), rng);
+        }
+
+        // Trains on a subset of the dataset only (e.g. every fold but one)
+        Trial(const SweepConfig& c, std::vector<size_t> indices, unsigned seed)
+        : config(c), net({784, c.hiddenSize, 10}), rng(seed), order(std::move(indices)) {
+            std::shuffle(order.begin(), order.end(), rng);
+        }
+    };
+
+    // Continues the trial's pass over its own shuffle for `budget` more samples
+    inline void trainTrial(Trial& t, const std::vector<ImgProc::Image>& dataset, size_t budget) {
+        std::uniform_int_distribution<int> shiftDist(-2, 2);
+        std::bernoulli_distribution coin(0.5);
+        std::uniform_real_distribution<float> scaleDist(0.85f, 1.15f);
+
+        for (size_t n = 0; n < budget; n++) {
+            if (t.cursor == t.order.size()) {
+                std::shuffle(t.order.begin(), t.order.end(), t.rng);
+                t.cursor = 0;
+            }
+            const auto& img = dataset[t.order[t.cursor++]];
+            t.net.train(img.pixels, img.target, t.config.learningRate);
+
+            if (t.config.augment) {
+                bool didAug = false;
+                std::vector<float> aug = img.pixels;
+                if (coin(t.rng)) {
+                    aug = ImgProc::MnistLoader::scaleImage(aug, scaleDist(t.rng));
+                    didAug = true;
+                }
+                if (coin(t.rng)) {
+                    aug = ImgProc::MnistLoader::translateImage(aug, shiftDist(t.rng), shiftDist(t.rng));
+                    didAug = true;
+                }
+                if (didAug) t.net.train(aug, img.target, t.config.learningRate);
+            }
+        }
+        t.samplesSeen += budget;
+    }
+
+    // Hyperparameter sweep with SUCCESSIVE HALVING. The dataset is loaded once and shared
+    // read-only by every trial (each only keeps its own index order).
+    //
+    //   rung 0: every config trains `minBudget` samples, then everyone is scored
+    //   rung k: the best 1/eta keep going with eta times the budget
+    //
+    // Trials of a rung run concurrently on the shared ThreadPool, one trial per task,
+    // biggest networks first so the long ones don't end up last.
+    class SweepRunner {
+    public:
+        const std::vector<ImgProc::Image>& trainSet;
+        const std::vector<ImgProc::Image>& validationSet;
+        size_t minBudget;
+        int eta;
+        std::vector<std::unique_ptr<Trial>> trials;
+
+        SweepRunner(const std::vector<ImgProc::Image>& train, const std::vector<ImgProc::Image>& validation,
+                    size_t budget = 10000, int reduction = 3)
+        : trainSet(train), validationSet(validation), minBudget(budget), eta(std::max(2, reduction)) {}
+
+        // Returns the best trial
+        Trial& run(const std::vector<SweepConfig>& configs) {
+            std::random_device rd;
+            trials.clear();
+            for (auto& c : configs) trials.push_back(std::make_unique<Trial>(c, trainSet.size(), rd()));
+
+            std::vector<Trial*> alive;
+            for (auto& t : trials) alive.push_back(t.get());
+            size_t budget = minBudget;
+
+            for (int rung = 0; !alive.empty(); rung++) {
+                std::cout << "Rung " << rung << ": " << alive.size() << " config(s), "
+                          << budget << " samples each" << std::endl;
+
+                std::sort(alive.begin(), alive.end(),
+                          [](Trial* a, Trial* b) { return a->config.hiddenSize > b->config.hiddenSize; });
+                ThreadPool::instance().parallelFor(0, alive.size(), 1, [&](size_t lo, size_t hi) {
+                    for (size_t i = lo; i < hi; i++) {
+                        trainTrial(*alive[i], trainSet, budget);
+                        alive[i]->accuracies.push_back(evaluate(alive[i]->net, validationSet).accuracy());
+                    }
+                });
+
+                // Keep the best 1/eta (at least one); stop once a single config is left
+                std::sort(alive.begin(), alive.end(),
+                          [](Trial* a, Trial* b) { return a->accuracies.back() > b->accuracies.back(); });
+                for (Trial* t : alive) {
+                    std::cout << "  " << std::setw(32) << std::left << t->config.name() << std::right
+                              << std::fixed << std::setprecision(2) << t->accuracies.back() << "%" << std::endl;
+                }
+                if (alive.size() == 1) break;
+                size_t keep = std::max<size_t>(1, alive.size() / eta);
+                for (size_t i = keep; i < alive.size(); i++) alive[i]->alive = false;
+                alive.resize(keep);
+                budget *= eta;
+            }
+            return *alive.front();
+        }
+
+        // One line per config: how far it got and its score at every rung
+        bool writeReport(const std::string& path) const {
+            std::ofstream file(path);
+            if (!file) {
+                std::cerr << "Error: Could not write " << path << std::endl;
+                return false;
+            }
+            std::vector<const Trial*> sorted;
+            for (auto& t : trials) sorted.push_back(t.get());
+            std::sort(sorted.begin(), sorted.end(), [](const Trial* a, const Trial* b) {
+                if (a->accuracies.size() != b->accuracies.size()) return a->accuracies.size() > b->accuracies.size();
+                return a->accuracies.back() > b->accuracies.back();
+            });
+
+            file << "learning_rate,hidden_size,augment,rungs,samples_seen,final_accuracy,accuracy_per_rung\n";
+            for (const Trial* t : sorted) {
+                file << t->config.learningRate << "," << t->config.hiddenSize << "," << (t->config.augment ? 1 : 0) << ","
+                     << t->accuracies.size() << "," << t->samplesSeen << "," << t->accuracies.back() << ",";
+                for (size_t r = 0; r < t->accuracies.size(); r++) file << (r ? ";" : "") << t->accuracies[r];
+                file << "\n";
+            }
+            std::cout << "Report written to " << path << std::endl;
+            return true;
+        }
+    };
+}
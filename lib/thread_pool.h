@@ -0,0 +1,175 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include <algorithm>
+#include <cstdlib>
+
+namespace NN {
+
+    // Work-stealing thread pool. Every worker owns a deque: it pushes/pops its own tasks at
+    // the back (LIFO, hot in cache) and, when it runs dry, steals from the FRONT of other
+    // workers' deques (the oldest, usually biggest, chunks).
+    //
+    // ONE POOL FOR EVERYTHING: use ThreadPool::instance() from training, evaluation and the
+    // loaders, so nested parallelFor calls share the same cores instead of each spawning
+    // their own threads. A thread waiting in parallelFor runs queued tasks itself, so nesting
+    // cannot deadlock.
+    class ThreadPool {
+    public:
+        // hardware_concurrency - 1 workers (the calling thread is the last one).
+        // Override with NN_NUM_THREADS=<n>.
+        static ThreadPool& instance() {
+            static ThreadPool pool(defaultWorkers());
+            return pool;
+        }
+
+        explicit ThreadPool(int numWorkers) {
+            for (int i = 0; i < numWorkers; i++) queues.push_back(std::make_unique<Queue>());
+            for (int i = 0; i < numWorkers; i++) {
+                threads.emplace_back([this, i] { workerLoop(i); });
+            }
+        }
+
+        ~ThreadPool() {
+            {
+                std::lock_guard<std::mutex> lock(sleepMutex);
+                stop = true;
+            }
+            sleepCv.notify_all();
+            for (auto& t : threads) t.join();
+        }
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        // Threads that can run work at the same time (workers + the caller)
+        int size() const { return static_cast<int>(threads.size()) + 1; }
+
+        void submit(std::function<void()> task) {
+            if (queues.empty()) {
+                task();
+                return;
+            }
+            int target = (workerIndex >= 0 && workerPool == this)
+                ? workerIndex
+                : static_cast<int>(nextQueue.fetch_add(1) % queues.size());
+            {
+                std::lock_guard<std::mutex> lock(queues[target]->mutex);
+                queues[target]->tasks.push_back(std::move(task));
+            }
+            {
+                std::lock_guard<std::mutex> lock(sleepMutex);
+                pending++;
+            }
+            sleepCv.notify_one();
+        }
+
+        // Calls fn(lo, hi) on chunks of [begin, end) of at least `grain` items and
+        // returns once all of them are done.
+        template <class F>
+        void parallelFor(size_t begin, size_t end, size_t grain, F&& fn) {
+            if (end <= begin) return;
+            const size_t n = end - begin;
+            grain = std::max<size_t>(1, grain);
+            if (queues.empty() || n <= grain) {
+                fn(begin, end);
+                return;
+            }
+
+            // A few chunks per thread so stealing can even out uneven chunks
+            size_t chunks = std::min((n + grain - 1) / grain, static_cast<size_t>(size()) * 4);
+            size_t chunkSize = (n + chunks - 1) / chunks;
+            chunks = (n + chunkSize - 1) / chunkSize;
+
+            std::atomic<size_t> remaining(chunks - 1);
+            for (size_t c = 1; c < chunks; c++) {
+                size_t lo = begin + c * chunkSize;
+                size_t hi = std::min(end, lo + chunkSize);
+                submit([&fn, &remaining, lo, hi] {
+                    fn(lo, hi);
+                    remaining.fetch_sub(1, std::memory_order_release);
+                });
+            }
+
+            // The caller does the first chunk, then helps until everything is finished
+            fn(begin, std::min(end, begin + chunkSize));
+            while (remaining.load(std::memory_order_acquire) > 0) {
+                if (!runOne()) std::this_thread::yield();
+            }
+        }
+
+    private:
+        struct Queue {
+            std::mutex mutex;
+            std::deque<std::function<void()>> tasks;
+        };
+
+        std::vector<std::unique_ptr<Queue>> queues;
+        std::vector<std::thread> threads;
+        std::atomic<size_t> nextQueue{0};
+
+        std::mutex sleepMutex;
+        std::condition_variable sleepCv;
+        size_t pending = 0;
+        bool stop = false;
+
+        inline static thread_local int workerIndex = -1;
+        inline static thread_local ThreadPool* workerPool = nullptr;
+
+        static int defaultWorkers() {
+            if (const char* env = std::getenv("NN_NUM_THREADS")) {
+                return std::max(0, std::atoi(env) - 1);
+            }
+            return std::max(0, static_cast<int>(std::thread::hardware_concurrency()) - 1);
+        }
+
+        // Own deque first (back), then steal from the others (front)
+        bool runOne() {
+            std::function<void()> task;
+            int self = (workerPool == this) ? workerIndex : -1;
+            const int n = static_cast<int>(queues.size());
+
+            if (self >= 0) {
+                std::lock_guard<std::mutex> lock(queues[self]->mutex);
+                if (!queues[self]->tasks.empty()) {
+                    task = std::move(queues[self]->tasks.back());
+                    queues[self]->tasks.pop_back();
+                }
+            }
+            for (int k = 1; !task && k <= n; k++) {
+                int victim = ((self < 0 ? 0 : self) + k) % n;
+                std::lock_guard<std::mutex> lock(queues[victim]->mutex);
+                if (!queues[victim]->tasks.empty()) {
+                    task = std::move(queues[victim]->tasks.front());
+                    queues[victim]->tasks.pop_front();
+                }
+            }
+            if (!task) return false;
+
+            {
+                std::lock_guard<std::mutex> lock(sleepMutex);
+                pending--;
+            }
+            task();
+            return true;
+        }
+
+        void workerLoop(int index) {
+            workerIndex = index;
+            workerPool = this;
+            while (true) {
+                if (runOne()) continue;
+                std::unique_lock<std::mutex> lock(sleepMutex);
+                sleepCv.wait(lock, [&] { return stop || pending > 0; });
+                if (stop) return;
+            }
+        }
+    };
+}
@@ -0,0 +1,329 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <random>
+#include <algorithm>
+#include <functional>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+
+#include "network.h"
+#include "image_processing.h"
+#include "idx.h"
+#include "evaluator.h"
+#include "coroutine.h"
+#include "async_reader.h"
+#include "sharded_dataset.h"
+
+namespace NN {
+
+    // The training loop as a chain of coroutine stages on the shared pool:
+    //
+    //     read -> augment (xN) -> decode (xN) -> batch -> train -> log -> checkpoint
+    //
+    // Stages talk through bounded Channels, so the next chunk is being read and decoded while
+    // the current batch trains (I/O and compute OVERLAP), and a stage that falls behind makes
+    // the ones before it wait instead of buffering the whole epoch (BACK-PRESSURE).
+    // A new stage is one more coroutine plus one more Channel in run(); no threads to manage.
+    //
+    // Augmentation runs on the raw uint8 records (translateImageU8 / scaleImageU8), before
+    // decode turns them into floats, so it moves a quarter of the bytes.
+    //
+    // ORDER: augment and decode run several copies, so chunks reach the batcher in any order
+    // and the first chunks of epoch e+1 may train before the tail of epoch e. Training itself
+    // is a single stage, so SGD updates are still applied one after another.
+    class TrainingPipeline {
+    public:
+        int epochs = 5;
+        float learningRate = 0.05f;
+        int augmentStart = 2;   // 1-based, first epoch with augmentation
+        int augmentEnd = 5;     // 1-based, last epoch with augmentation
+        int chunkSize = 512;    // records per read
+        int batchSize = 64;     // samples handed to the trainer at once
+        int workers = 2;        // copies of the decode and augment stages
+        size_t queueDepth = 4;  // items per channel
+        std::string checkpointPath = "mnist_model.bin"; // saved after every epoch, "" = off
+
+        // Streams the training set from the IDX files every epoch. `testData` (may be empty)
+        // is used by the log stage to report accuracy after each epoch.
+        bool run(NeuralNetwork& net, const std::string& imagePath, const std::string& labelPath,
+                 const std::vector<ImgProc::Image>& testData = {}) {
+            IdxStream imgHeader, lblHeader;
+            if (!imgHeader.open(imagePath) || !lblHeader.open(labelPath)) return false;
+            const IdxHeader& images = imgHeader.header();
+            const IdxHeader& labels = lblHeader.header();
+            if (images.type != IdxType::U8 || labels.type != IdxType::U8 || labels.rank() != 1 ||
+                images.records() != labels.records() || images.records() == 0) {
+                std::cerr << "Error: Expected u8 images and labels with matching counts, got "
+                          << images.shape() << " & " << labels.shape() << std::endl;
+                return false;
+            }
+            recordSize = static_cast<uint32_t>(images.recordElements());
+            const uint64_t imgBase = images.dataOffset(), lblBase = labels.dataOffset();
+            AsyncReader imgReader, lblReader;
+            if (!imgReader.open(imagePath) || !lblReader.open(labelPath)) return false;
+
+            std::vector<ReadRequest> imgReads, lblReads;
+            std::vector<uint8_t> labelBytes;
+            auto gather = [&](const uint64_t* ids, size_t n, uint8_t* pixels, int* labels) {
+                imgReads.clear();
+                lblReads.clear();
+                labelBytes.resize(n);
+                for (size_t i = 0; i < n; i++) {
+                    imgReads.push_back({imgBase + ids[i] * recordSize, recordSize, pixels + i * recordSize});
+                    lblReads.push_back({lblBase + ids[i], 1, &labelBytes[i]});
+                }
+                if (!imgReader.read(imgReads) || !lblReader.read(lblReads)) return false;
+                for (size_t i = 0; i < n; i++) labels[i] = labelBytes[i];
+                return true;
+            };
+            return runStages(net, images.records(), gather, testData);
+        }
+
+        // Same, from a sharded dataset (see convert_dataset): samples are gathered across
+        // shards by id, so the per-epoch shuffle is global however many shards there are
+        bool run(NeuralNetwork& net, const ShardedDataset& dataset, const std::vector<ImgProc::Image>& testData = {}) {
+            if (!dataset.isOpen() || dataset.size() == 0) return false;
+            recordSize = dataset.sampleBytes();
+            ShardedDataset::Reader reader(dataset);
+            auto gather = [&](const uint64_t* ids, size_t n, uint8_t* pixels, int* labels) {
+                return reader.gather(ids, n, pixels, labels);
+            };
+            return runStages(net, dataset.size(), gather, testData);
+        }
+
+    private:
+        // Fills pixels[k * recordSize] and labels[k] for each of the n record ids
+        using GatherFn = std::function<bool(const uint64_t* ids, size_t n, uint8_t* pixels, int* labels)>;
+
+        struct RawChunk {
+            int epoch = 0;
+            int count = 0;
+            std::vector<uint8_t> pixels; // [count][recordSize]
+            std::vector<int> labels;
+        };
+        struct SampleChunk {
+            int epoch = 0;
+            std::vector<ImgProc::Image> samples;
+        };
+        struct Batch {
+            int epoch = 0;
+            bool lastOfEpoch = false;
+            std::vector<ImgProc::Image> samples;
+        };
+        struct Progress {
+            int epoch = 0;
+            size_t samples = 0; // trained in this epoch
+            double seconds = 0;
+            std::shared_ptr<NeuralNetwork> snapshot; // weights at the end of the epoch
+        };
+
+        uint64_t numRecords = 0;
+        uint32_t recordSize = 0;
+        bool readFailed = false;
+
+        bool runStages(NeuralNetwork& net, uint64_t count, const GatherFn& gather, const std::vector<ImgProc::Image>& testData) {
+            // Zero would stall a stage forever (no progress in the read loop, a channel that
+            // never has room, a batch that never fills, no consumer at all)
+            if (chunkSize <= 0 || batchSize <= 0 || workers <= 0 || queueDepth == 0) {
+                std::cerr << "Error: TrainingPipeline needs chunkSize, batchSize, workers and queueDepth >= 1." << std::endl;
+                return false;
+            }
+            numRecords = count;
+            readFailed = false;
+
+            CoroScheduler scheduler;
+            Channel<RawChunk> raw(scheduler, queueDepth);
+            Channel<RawChunk> augmented(scheduler, queueDepth, workers);
+            Channel<SampleChunk> decoded(scheduler, queueDepth, workers);
+            Channel<Batch> batches(scheduler, queueDepth);
+            Channel<Progress> progress(scheduler, queueDepth);
+            Channel<Progress> checkpoints(scheduler, 1);
+
+            readStage(gather, raw).spawn(scheduler);
+            for (int w = 0; w < workers; w++) augmentStage(raw, augmented, w).spawn(scheduler);
+            for (int w = 0; w < workers; w++) decodeStage(augmented, decoded).spawn(scheduler);
+            batchStage(decoded, batches).spawn(scheduler);
+            trainStage(net, batches, progress).spawn(scheduler);
+            logStage(progress, checkpoints, testData).spawn(scheduler);
+            checkpointStage(checkpoints).spawn(scheduler);
+
+            scheduler.run();
+            return !readFailed;
+        }
+
+        // 1. READ: a fresh permutation of ALL records every epoch (RandomPermutation, no id
+        // array), gathered chunk by chunk with batched async reads
+        Task readStage(const GatherFn& gather, Channel<RawChunk>& out) {
+            std::mt19937_64 rng(std::random_device{}());
+            std::vector<uint64_t> ids;
+
+            for (int e = 0; e < epochs && !readFailed; e++) {
+                RandomPermutation order(numRecords, rng());
+                for (uint64_t first = 0; first < numRecords; first += chunkSize) {
+                    RawChunk chunk;
+                    chunk.epoch = e;
+                    chunk.count = static_cast<int>(std::min<uint64_t>(chunkSize, numRecords - first));
+                    chunk.pixels.resize(static_cast<size_t>(chunk.count) * recordSize);
+                    chunk.labels.resize(chunk.count);
+                    ids.resize(chunk.count);
+                    for (int i = 0; i < chunk.count; i++) ids[i] = order[first + i];
+                    if (!gather(ids.data(), ids.size(), chunk.pixels.data(), chunk.labels.data())) {
+                        std::cerr << "Error: Reading the training set failed." << std::endl;
+                        readFailed = true;
+                        break;
+                    }
+                    co_await out.send(std::move(chunk)); // waits while augment is behind
+                }
+            }
+            out.close();
+        }
+
+        // 2. AUGMENT: same policy as the old loop, each original may be followed by a
+        // scaled and/or shifted copy during the augmentation epochs (uint8 kernels)
+        Task augmentStage(Channel<RawChunk>& in, Channel<RawChunk>& out, int seed) {
+            std::mt19937 rng(std::random_device{}() + seed);
+            std::uniform_int_distribution<int> shiftDist(-2, 2);
+            std::bernoulli_distribution translateProb(0.5);
+            std::bernoulli_distribution scaleProb(0.5);
+            std::uniform_real_distribution<float> scaleDist(0.85f, 1.15f);
+            std::vector<uint8_t> scratch(recordSize);
+
+            while (auto chunk = co_await in.receive()) {
+                const bool enabled = (chunk->epoch + 1) >= augmentStart && (chunk->epoch + 1) <= augmentEnd;
+                if (!enabled) {
+                    co_await out.send(std::move(*chunk));
+                    continue;
+                }
+                RawChunk result;
+                result.epoch = chunk->epoch;
+                result.pixels.reserve(chunk->pixels.size() * 2);
+                result.labels.reserve(chunk->labels.size() * 2);
+                for (int i = 0; i < chunk->count; i++) {
+                    const uint8_t* img = &chunk->pixels[static_cast<size_t>(i) * recordSize];
+                    result.pixels.insert(result.pixels.end(), img, img + recordSize);
+                    result.labels.push_back(chunk->labels[i]);
+
+                    const bool scaled = scaleProb(rng);
+                    const float s = scaled ? scaleDist(rng) : 1.0f;
+                    const bool shifted = translateProb(rng);
+                    if (!scaled && !shifted) continue;
+
+                    const size_t at = result.pixels.size();
+                    result.pixels.resize(at + recordSize);
+                    uint8_t* aug = &result.pixels[at];
+                    if (scaled && shifted) {
+                        ImgProc::MnistLoader::scaleImageU8(img, scratch.data(), s);
+                        int dx = shiftDist(rng);
+                        int dy = shiftDist(rng);
+                        ImgProc::MnistLoader::translateImageU8(scratch.data(), aug, dx, dy);
+                    } else if (scaled) {
+                        ImgProc::MnistLoader::scaleImageU8(img, aug, s);
+                    } else {
+                        int dx = shiftDist(rng);
+                        int dy = shiftDist(rng);
+                        ImgProc::MnistLoader::translateImageU8(img, aug, dx, dy);
+                    }
+                    result.labels.push_back(chunk->labels[i]);
+                }
+                result.count = static_cast<int>(result.labels.size());
+                co_await out.send(std::move(result));
+            }
+            out.close();
+        }
+
+        // 3. DECODE: bytes -> normalised images with one-hot targets
+        Task decodeStage(Channel<RawChunk>& in, Channel<SampleChunk>& out) {
+            while (auto chunk = co_await in.receive()) {
+                SampleChunk decoded;
+                decoded.epoch = chunk->epoch;
+                decoded.samples.resize(chunk->count);
+                for (int i = 0; i < chunk->count; i++) {
+                    ImgProc::Image& img = decoded.samples[i];
+                    img.label = chunk->labels[i];
+                    img.target.assign(10, 0.0f);
+                    if (img.label >= 0 && img.label < 10) img.target[img.label] = 1.0f;
+                    const unsigned char* src = &chunk->pixels[static_cast<size_t>(i) * recordSize];
+                    img.pixels.resize(recordSize);
+                    for (uint32_t j = 0; j < recordSize; j++) img.pixels[j] = src[j] / 255.0f;
+                }
+                co_await out.send(std::move(decoded));
+            }
+            out.close();
+        }
+
+        // 4. BATCH: regroups chunks into fixed-size batches and marks the end of each epoch
+        // (the chunk count per epoch is known, the sample count isn't once augmented)
+        Task batchStage(Channel<SampleChunk>& in, Channel<Batch>& out) {
+            const uint64_t chunksPerEpoch = (numRecords + chunkSize - 1) / chunkSize;
+            std::vector<uint64_t> seen(epochs, 0);
+            std::vector<Batch> pending(epochs);
+
+            while (auto chunk = co_await in.receive()) {
+                const int e = chunk->epoch;
+                Batch& batch = pending[e];
+                batch.epoch = e;
+                for (auto& img : chunk->samples) {
+                    batch.samples.push_back(std::move(img));
+                    if (static_cast<int>(batch.samples.size()) == batchSize) {
+                        Batch full;
+                        full.epoch = e;
+                        full.samples.swap(batch.samples);
+                        co_await out.send(std::move(full));
+                    }
+                }
+                if (++seen[e] == chunksPerEpoch) {
+                    batch.lastOfEpoch = true;
+                    co_await out.send(std::move(batch));
+                    pending[e] = Batch();
+                }
+            }
+            out.close();
+        }
+
+        // 5. TRAIN: the only stage that touches `net`, one SGD step per sample as before
+        Task trainStage(NeuralNetwork& net, Channel<Batch>& in, Channel<Progress>& out) {
+            std::vector<size_t> trained(epochs, 0);
+            auto start = std::chrono::steady_clock::now();
+
+            while (auto batch = co_await in.receive()) {
+                for (auto& img : batch->samples) net.train(img.pixels, img.target, learningRate);
+                trained[batch->epoch] += batch->samples.size();
+
+                if (batch->lastOfEpoch) {
+                    Progress p;
+                    p.epoch = batch->epoch;
+                    p.samples = trained[batch->epoch];
+                    p.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                    p.snapshot = std::make_shared<NeuralNetwork>(net); // log/save it while training goes on
+                    co_await out.send(std::move(p));
+                }
+            }
+            out.close();
+        }
+
+        // 6. LOG: test accuracy of each epoch's snapshot
+        Task logStage(Channel<Progress>& in, Channel<Progress>& out, const std::vector<ImgProc::Image>& testData) {
+            while (auto p = co_await in.receive()) {
+                std::cout << "Epoch " << (p->epoch + 1) << "/" << epochs << ": " << p->samples << " samples";
+                if (!testData.empty()) {
+                    std::cout << ", test accuracy " << std::fixed << std::setprecision(2)
+                              << evaluate(*p->snapshot, testData).accuracy() << "%";
+                }
+                std::cout << " (" << std::setprecision(1) << p->seconds << "s)" << std::endl;
+                co_await out.send(std::move(*p));
+            }
+            out.close();
+        }
+
+        // 7. CHECKPOINT: atomic save, so a running draw app hot-reloads every epoch
+        Task checkpointStage(Channel<Progress>& in) {
+            while (auto p = co_await in.receive()) {
+                if (!checkpointPath.empty()) p->snapshot->save(checkpointPath);
+            }
+        }
+    };
+}
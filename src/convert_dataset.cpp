@@ -0,0 +1,129 @@
+#include "../lib/sharded_dataset.h"
+#include "../lib/idx.h"
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <charconv>
+
+// Converts MNIST-style data into a sharded dataset directory (see lib/sharded_dataset.h).
+//     ./convert_dataset --idx train-images.idx3-ubyte train-labels.idx1-ubyte --out mnist_train
+//     ./convert_dataset --csv mnist_train.csv --out mnist_train --shard-samples 100000
+// CSV rows are "label,p0,p1,...,p783" with 0-255 pixels; a header row is skipped.
+// Both inputs are streamed, so datasets bigger than RAM convert fine.
+
+// Any u8 IDX image file (MNIST, EMNIST, Fashion-MNIST) with an integer label file
+static bool convertIdx(const std::string& imagePath, const std::string& labelPath, NN::ShardWriter& writer) {
+    NN::IdxStream img, lbl;
+    if (!img.open(imagePath) || !lbl.open(labelPath)) return false;
+    const NN::IdxHeader& images = img.header();
+    const NN::IdxHeader& labels = lbl.header();
+    if (images.type != NN::IdxType::U8 || labels.rank() != 1 || images.records() != labels.records()) {
+        std::cerr << "Error: Expected u8 images and one label per image, got "
+                  << images.shape() << " & " << labels.shape() << std::endl;
+        return false;
+    }
+
+    // Chunks of records, never the whole file
+    const size_t recordSize = images.recordElements();
+    const uint64_t chunk = 4096;
+    std::vector<uint8_t> pixels(chunk * recordSize);
+    std::vector<int32_t> labelValues(chunk);
+    while (img.remaining() > 0) {
+        const uint64_t n = img.read(chunk, pixels.data());
+        if (n == 0 || lbl.read(n, labelValues.data()) != n) return false;
+        for (uint64_t i = 0; i < n; i++) {
+            if (!writer.add(&pixels[i * recordSize], static_cast<uint32_t>(recordSize), labelValues[i])) return false;
+        }
+    }
+    return true;
+}
+
+static bool convertCsv(const std::string& path, NN::ShardWriter& writer, uint32_t recordSize) {
+    std::ifstream in(path);
+    if (!in.is_open()) {
+        std::cerr << "Error: Could not open " << path << std::endl;
+        return false;
+    }
+    std::string line;
+    std::vector<uint8_t> pixels(recordSize);
+    size_t lineNo = 0;
+    while (std::getline(in, line)) {
+        lineNo++;
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (line.empty()) continue;
+
+        const char* p = line.data();
+        const char* end = p + line.size();
+        int label = 0;
+        auto parsed = std::from_chars(p, end, label);
+        if (parsed.ec != std::errc()) {
+            if (lineNo == 1) continue; // header row
+            std::cerr << "Error: " << path << ":" << lineNo << ": expected a label" << std::endl;
+            return false;
+        }
+        p = parsed.ptr;
+        for (uint32_t j = 0; j < recordSize; j++) {
+            int value = -1;
+            if (p < end && *p == ',') {
+                auto result = std::from_chars(p + 1, end, value);
+                if (result.ec != std::errc()) value = -1;
+                p = result.ptr;
+            }
+            if (value < 0 || value > 255) {
+                std::cerr << "Error: " << path << ":" << lineNo << ": expected " << recordSize << " pixels (0-255)" << std::endl;
+                return false;
+            }
+            pixels[j] = static_cast<uint8_t>(value);
+        }
+        if (!writer.add(pixels.data(), recordSize, label)) return false;
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    std::string idxImages, idxLabels, csvPath, outDir;
+    uint64_t samplesPerShard = 1 << 20;
+    uint32_t rows = 28, cols = 28; // CSV only, IDX files carry their own shape
+
+    for (int i = 1; i < argc; i++) {
+        std::string key = argv[i];
+        auto value = [&]() -> std::string { return i + 1 < argc ? argv[++i] : ""; };
+        if (key == "--idx") {
+            idxImages = value();
+            idxLabels = value();
+        }
+        else if (key == "--csv") csvPath = value();
+        else if (key == "--out") outDir = value();
+        else if (key == "--shard-samples") samplesPerShard = std::stoull(value());
+        else if (key == "--rows") rows = std::stoul(value());
+        else if (key == "--cols") cols = std::stoul(value());
+        else {
+            std::cerr << "Error: unknown option " << key << std::endl;
+            return 1;
+        }
+    }
+    if (outDir.empty() || (idxImages.empty() == csvPath.empty()) || (!idxImages.empty() && idxLabels.empty())) {
+        std::cerr << "Usage: convert_dataset (--idx <images> <labels> | --csv <file>) --out <dir> [--shard-samples N]" << std::endl;
+        return 1;
+    }
+
+    if (!idxImages.empty()) {
+        // The shape comes from the IDX header, so peek at it before creating the writer
+        NN::IdxStream peek;
+        if (!peek.open(idxImages)) return 1;
+        const NN::IdxHeader& h = peek.header();
+        if (h.recordElements() == 0) {
+            std::cerr << "Error: " << idxImages << " has empty records (" << h.shape() << ")." << std::endl;
+            return 1;
+        }
+        rows = h.rank() > 1 ? h.dims[1] : 1;
+        cols = h.rank() > 2 ? static_cast<uint32_t>(h.recordElements() / rows) : 1;
+    }
+
+    NN::ShardWriter writer(outDir, rows, cols, samplesPerShard);
+    bool ok = idxImages.empty() ? convertCsv(csvPath, writer, rows * cols)
+                                : convertIdx(idxImages, idxLabels, writer);
+    if (!ok) return 1;
+    return writer.finish() ? 0 : 1;
+}
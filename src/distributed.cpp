@@ -0,0 +1,183 @@
+#include "../lib/network.h"
+#include "../lib/image_processing.h"
+#include "../lib/distributed.h"
+#include "../lib/parameter_server.h"
+#include "../lib/evaluator.h"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Multi-process data-parallel training.
+//
+// RING MODE (synchronous all-reduce). One host, N processes (the launcher forks them):
+//     ./distributed --world 4
+//     ./distributed --world 4 --address tcp:127.0.0.1:29500
+//     ./distributed --world 4 --compression topk-int8 --topk 0.01
+// Several hosts, one command per process:
+//     ./distributed --world 2 --rank 0 --address tcp:hostA,hostB:29500
+//     ./distributed --world 2 --rank 1 --address tcp:hostA,hostB:29500
+//
+// PARAMETER-SERVER MODE (asynchronous, one host). The launcher is the server and forks
+// N workers; or start the server and each worker separately:
+//     ./distributed --mode ps --world 4 --staleness 4
+//     ./distributed --mode ps --world 4 --rank server
+//     ./distributed --mode ps --world 4 --rank 0    (... up to --rank 3)
+
+struct Options {
+    std::string basePath = "/home/manuel/Projects/NeuralNetwok/dataset/MNIST_CSV/"; // Update path !!!!!!!!!!!!!!!!!
+    std::string mode = "ring";
+    std::string address = "unix:/tmp/nn_ring";
+    std::string shmName = "/nn_params";
+    int world = 2;
+    int rank = -1; // -1 = launch every process on this host, -2 = parameter server only
+    int epochs = 5;
+    int batchSize = 16; // per process
+    float learningRate = 0.5f; // applied to the mean gradient of a batch
+    NN::Compression compression = NN::Compression::None;
+    float topK = 0.01f;
+    int staleness = 4;
+};
+
+static void report(NN::NeuralNetwork& net, const Options& opt) {
+    auto testData = ImgProc::MnistLoader::load(opt.basePath + "t10k-images.idx3-ubyte", opt.basePath + "t10k-labels.idx1-ubyte");
+    if (!testData.empty()) {
+        NN::EvalResult result = NN::evaluate(net, testData);
+        std::cout << "Test accuracy: " << result.accuracy() << "% (" << result.correct << "/" << result.total << ")" << std::endl;
+    }
+    net.save("mnist_model.bin");
+}
+
+static int runRingWorker(int rank, const Options& opt) {
+    auto trainingData = ImgProc::MnistLoader::load(opt.basePath + "train-images.idx3-ubyte", opt.basePath + "train-labels.idx1-ubyte");
+    if (trainingData.empty()) return 1;
+
+    NN::NeuralNetwork net({784, 64, 10});
+    NN::RingCommunicator comm(rank, opt.world, opt.address);
+    if (!comm.connect()) return 1;
+
+    NN::DistributedTrainer trainer(net, comm);
+    trainer.compression = opt.compression;
+    trainer.topKRatio = opt.topK;
+    if (!trainer.train(trainingData, opt.epochs, opt.batchSize, opt.learningRate)) return 1;
+
+    // Every replica is identical, rank 0 reports and exports
+    if (rank == 0) report(net, opt);
+    return 0;
+}
+
+static int runAsyncWorker(int rank, const Options& opt) {
+    auto trainingData = ImgProc::MnistLoader::load(opt.basePath + "train-images.idx3-ubyte", opt.basePath + "train-labels.idx1-ubyte");
+    if (trainingData.empty()) return 1;
+
+    std::vector<ImgProc::Image> shard;
+    for (size_t i = rank; i < trainingData.size(); i += opt.world) shard.push_back(std::move(trainingData[i]));
+
+    NN::SharedParameters params;
+    if (!params.attach(opt.shmName)) return 1;
+    NN::NeuralNetwork replica({784, 64, 10});
+    NN::AsyncWorker worker(params, replica, rank);
+    return worker.train(shard, opt.epochs, opt.batchSize) ? 0 : 1;
+}
+
+// The launcher's worker processes
+struct Children {
+    std::vector<pid_t> pids;
+    std::vector<int> status; // wait status, -1 while still running
+
+    void add(pid_t pid) {
+        pids.push_back(pid);
+        status.push_back(-1);
+    }
+
+    // Collects the workers that exited so far without blocking; returns how many have
+    int reap() {
+        int exited = 0;
+        for (size_t i = 0; i < pids.size(); i++) {
+            if (status[i] < 0 && waitpid(pids[i], &status[i], WNOHANG) <= 0) status[i] = -1;
+            if (status[i] >= 0) exited++;
+        }
+        return exited;
+    }
+
+    // Waits for the rest; returns how many failed
+    int waitAll() {
+        int failed = 0;
+        for (size_t i = 0; i < pids.size(); i++) {
+            if (status[i] < 0) waitpid(pids[i], &status[i], 0);
+            if (!WIFEXITED(status[i]) || WEXITSTATUS(status[i]) != 0) failed++;
+        }
+        if (failed) std::cerr << "Error: " << failed << " worker(s) failed." << std::endl;
+        return failed;
+    }
+};
+
+int main(int argc, char** argv) {
+    Options opt;
+
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string key = argv[i];
+        std::string value = argv[i + 1];
+        if (key == "--world") opt.world = std::stoi(value);
+        else if (key == "--rank") opt.rank = (value == "server") ? -2 : std::stoi(value);
+        else if (key == "--mode") opt.mode = value;
+        else if (key == "--address") opt.address = value;
+        else if (key == "--shm") opt.shmName = value;
+        else if (key == "--data") opt.basePath = value;
+        else if (key == "--epochs") opt.epochs = std::stoi(value);
+        else if (key == "--batch") opt.batchSize = std::stoi(value);
+        else if (key == "--lr") opt.learningRate = std::stof(value);
+        else if (key == "--topk") opt.topK = std::stof(value);
+        else if (key == "--staleness") opt.staleness = std::stoi(value);
+        else if (key == "--compression") {
+            if (!NN::parseCompression(value, opt.compression)) {
+                std::cerr << "Error: --compression must be none, topk, int8 or topk-int8." << std::endl;
+                return 1;
+            }
+        }
+        else {
+            std::cerr << "Error: unknown option " << key << std::endl;
+            return 1;
+        }
+    }
+    if (opt.world < 1 || opt.rank >= opt.world || (opt.mode != "ring" && opt.mode != "ps")) {
+        std::cerr << "Error: need --mode ring|ps, --world >= 1 and --rank < --world." << std::endl;
+        return 1;
+    }
+    if (opt.batchSize <= 0) {
+        std::cerr << "Error: --batch must be at least 1." << std::endl;
+        return 1;
+    }
+    const bool ps = (opt.mode == "ps");
+    if (!ps && opt.rank == -2) {
+        std::cerr << "Error: --rank server only exists in --mode ps." << std::endl;
+        return 1;
+    }
+
+    if (opt.rank >= 0) return ps ? runAsyncWorker(opt.rank, opt) : runRingWorker(opt.rank, opt);
+
+    // LAUNCHER: fork one process per rank (before any thread exists) and wait for all of them
+    NN::NeuralNetwork net({784, 64, 10});
+    NN::SharedParameters params;
+    if (ps && !params.create(opt.shmName, net, opt.world)) return 1;
+
+    Children children;
+    for (int r = 0; r < opt.world && opt.rank == -1; r++) {
+        pid_t pid = fork();
+        if (pid == 0) _exit(ps ? runAsyncWorker(r, opt) : runRingWorker(r, opt));
+        if (pid < 0) {
+            std::cerr << "Error: fork failed." << std::endl;
+            return 1;
+        }
+        children.add(pid);
+    }
+
+    if (ps) {
+        NN::ParameterServer server(params, opt.learningRate, opt.staleness);
+        // Dead children count as done, or one crashed worker would keep the server waiting
+        server.serve(net, [&] { return children.reap(); });
+        report(net, opt);
+    }
+    return children.waitAll() ? 1 : 0;
+}
@@ -1,4 +1,7 @@
 #include "../lib/network.h"
+#include "../lib/image_processing.h"
+#include "../lib/online_learning.h"
+#include "../lib/model_watcher.h"
 #include <SFML/Graphics.hpp>
 #include <iostream>
 #include <vector>
@@ -13,13 +16,25 @@ int main() {
     // 1. Load the Trained Model
     // Safe dummy values. load() will overwrite them anyway.
     NN::NeuralNetwork net({1, 1, 1});
-    net.load("mnist_model.bin"); // Load structure and weights from file
-
-    if (net.layers.empty()) {
+    // A missing file leaves the dummy layers in place, so the result has to be checked
+    if (!net.loadMapped("mnist_model.bin") || net.layers.empty()) {
         std::cerr << "Could not load model. Run the trainer first!" << std::endl;
         return 1;
     }
 
+    // ONLINE LEARNING: press 0-9 to teach the model what you drew. A background thread
+    // fine-tunes a copy (mixed with MNIST replay) and swaps it in; drawing never waits.
+    // Update path !!!!!!!!!!!!!!!!!
+    std::string basePath = "/home/manuel/Projects/NeuralNetwok/dataset/MNIST_CSV/";
+    NN::OnlineTrainer online(net, [basePath] {
+        return ImgProc::MnistLoader::load(basePath + "train-images.idx3-ubyte", basePath + "train-labels.idx1-ubyte");
+    });
+
+    // HOT RELOAD: a retrained mnist_model.bin is loaded in the background and swapped in
+    NN::ModelWatcher watcher("mnist_model.bin", [&online](NN::NeuralNetwork&& fresh) {
+        online.replaceModel(std::move(fresh));
+    });
+
     // 2. Setup Drawing Window
     const int CELL_SIZE = 20;
     const int GRID_SIZE = 28;
@@ -57,6 +72,11 @@ int main() {
                 if (event.key.code == sf::Keyboard::C || event.key.code == sf::Keyboard::Space) {
                     std::fill(canvas.begin(), canvas.end(), 0.0f);
                 }
+                // Label the canvas with its true digit
+                if (event.key.code >= sf::Keyboard::Num0 && event.key.code <= sf::Keyboard::Num9) {
+                    online.addSample(canvas, event.key.code - sf::Keyboard::Num0);
+                    std::fill(canvas.begin(), canvas.end(), 0.0f);
+                }
             }
 
             // Mouse Input
@@ -93,15 +113,17 @@ int main() {
             }
         }
 
-        // Real-time Prediction
-        auto output = net.feedForward(canvas);
+        // Real-time Prediction (on the latest published snapshot)
+        auto model = online.current();
+        auto output = model->predict(canvas);
         int guess = getPrediction(output);
         float conf = output[guess];
 
         // Update Text
         std::string info = "Prediction: " + std::to_string(guess) + "\n\n";
         info += "Confidence: \n" + std::to_string((int)(conf * 100)) + "%\n\n";
-        info += "[Left Click] Draw\n[Right Click] Erase\n[Space] Clear";
+        info += "[Left Click] Draw\n[Right Click] Erase\n[Space] Clear\n[0-9] Teach label\n\n";
+        info += "Learned: " + std::to_string(online.userSamples()) + "\nModel v" + std::to_string(online.version());
         text.setString(info);
 
         // Render
@@ -123,5 +145,11 @@ int main() {
         window.draw(text);
         window.display();
     }
+
+    // Keep what was learned, without overwriting the original model
+    if (online.userSamples() > 0) {
+        NN::NeuralNetwork tuned = *online.current();
+        tuned.save("mnist_model_finetuned.bin");
+    }
     return 0;
 }
@@ -1,10 +1,10 @@
 #include "../lib/network.h"
 #include "../lib/image_processing.h"
+#include "../lib/training_pipeline.h"
 #include <iostream>
 #include <filesystem>
 #include <SFML/Graphics.hpp>
 #include <iomanip> // For std::setprecision
-#include <random>
 
 // Helper to find the index of the max value
 int getPrediction(const std::vector<float>& output) {
@@ -32,63 +32,26 @@ int main() {
     }
 
     std::cout << "Loading Data..." << std::endl;
-    auto trainingData = ImgProc::MnistLoader::load(basePath + "train-images.idx3-ubyte", basePath + "train-labels.idx1-ubyte");
     auto testData = ImgProc::MnistLoader::load(basePath + "t10k-images.idx3-ubyte", basePath + "t10k-labels.idx1-ubyte");
 
-    if (trainingData.empty() || testData.empty()) return 1;
+    if (testData.empty()) return 1;
 
     NN::NeuralNetwork net({784, 64, 10}); // Neural Network Layers - - -
 
-    // Setup RNG for on-the-fly augmentation (scaling + translation)
-    std::random_device rd;
-    std::mt19937 rng(rd());
-    std::uniform_int_distribution<int> shiftDist(-2, 2); // shift by -2..2 pixels
-    std::bernoulli_distribution translateProb(0.5); // 50% chance to translate
-    std::bernoulli_distribution scaleProb(0.5); // 50% chance to scale
-    std::uniform_real_distribution<float> scaleDist(0.85f, 1.15f); // scale range
-
-    int epochs = 5; // number of epochs to train
-    // Augmentation schedule: only apply augmentation for epochs in [augment_start, augment_end]
-    int augment_start = 2; // 1-based epoch index when augmentation begins
-    int augment_end = 5;   // 1-based epoch index when augmentation ends
-    std::cout << "Training (" << epochs << " epochs, with augmentation)..." << std::endl;
-
-    for (int e = 0; e < epochs; ++e) {
-        std::shuffle(trainingData.begin(), trainingData.end(), rng);
-        std::cout << "Epoch " << (e + 1) << "/" << epochs << "\n";
-
-        bool augmentEnabledThisEpoch = ( (e+1) >= augment_start && (e+1) <= augment_end );
-
-        for (const auto& img : trainingData) {
-            // 1) Train on the original image
-            net.train(img.pixels, img.target, 0.05f);
-
-            // 2) Optionally create an augmented copy and train on it as well
-            bool didAug = false;
-            std::vector<float> aug = img.pixels;
-
-            if (augmentEnabledThisEpoch && scaleProb(rng)) {
-                float s = scaleDist(rng);
-                aug = ImgProc::MnistLoader::scaleImage(aug, s);
-                didAug = true;
-            }
-            if (augmentEnabledThisEpoch && translateProb(rng)) {
-                int dx = shiftDist(rng);
-                int dy = shiftDist(rng);
-                aug = ImgProc::MnistLoader::translateImage(aug, dx, dy);
-                didAug = true;
-            }
-
-            if (didAug) {
-                net.train(aug, img.target, 0.05f);
-            }
-        }
-    }
+    // The training set is streamed through coroutine stages (read, augment, decode, batch,
+    // train, log, checkpoint): the next chunks load and augment while the current one trains.
+    // Augmentation only runs for epochs in [augmentStart, augmentEnd] (1-based).
+    NN::TrainingPipeline pipeline;
+    pipeline.epochs = 5; // number of epochs to train
+    pipeline.learningRate = 0.05f;
+    pipeline.augmentStart = 2;
+    pipeline.augmentEnd = 5;
+    pipeline.checkpointPath = "mnist_model.bin"; // EXPORT THE MODEL after every epoch
+    std::cout << "Training (" << pipeline.epochs << " epochs, with augmentation)..." << std::endl;
+
+    if (!pipeline.run(net, basePath + "train-images.idx3-ubyte", basePath + "train-labels.idx1-ubyte", testData)) return 1;
     std::cout << "Training Complete." << std::endl;
 
-    // EXPORT THE MODEL
-    net.save("mnist_model.bin");
-
 
 
 
@@ -0,0 +1,89 @@
+#include "../lib/network.h"
+#include "../lib/image_processing.h"
+#include "../lib/evaluator.h"
+#include "../lib/pruning.h"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+
+// Shrinks a trained model by removing its least useful hidden neurons (see lib/pruning.h).
+//     ./prune --model mnist_model.bin --out mnist_pruned.bin --keep 0.5 --finetune 1
+// The result is an ordinary dense model: main/draw load it like any other.
+
+// Test-set accuracy and mean inference time per sample
+static void report(const std::string& name, const NN::NeuralNetwork& net, const std::vector<ImgProc::Image>& testData) {
+    auto start = std::chrono::steady_clock::now();
+    NN::EvalResult result = NN::evaluate(net, testData);
+    double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << name << ": ";
+    for (size_t i = 0; i < net.layers.size(); i++) {
+        if (const auto* l = std::get_if<NN::Layer>(&net.layers[i])) {
+            std::cout << (i == 0 ? "" : "-") << (i == 0 ? std::to_string(l->numNodesIn) + "-" : "") << l->numNodesOut;
+        }
+    }
+    std::cout << ", test accuracy " << result.accuracy() << "%, "
+              << us / std::max<size_t>(1, testData.size()) << " us/sample" << std::endl;
+}
+
+int main(int argc, char** argv) {
+    // Update path !!!!!!!!!!!!!!!!!
+    std::string basePath = "/home/manuel/Projects/NeuralNetwok/dataset/MNIST_CSV/";
+    std::string modelPath = "mnist_model.bin";
+    std::string outPath = "mnist_pruned.bin";
+    NN::NeuronPruner pruner;
+
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string key = argv[i];
+        std::string value = argv[i + 1];
+        if (key == "--data") basePath = value;
+        else if (key == "--model") modelPath = value;
+        else if (key == "--out") outPath = value;
+        else if (key == "--keep") pruner.keepRatio = std::stof(value);
+        else if (key == "--calibration") pruner.calibrationSamples = std::stoul(value);
+        else if (key == "--finetune") pruner.fineTuneEpochs = std::stoi(value);
+        else if (key == "--finetune-samples") pruner.fineTuneSamples = std::stoul(value);
+        else if (key == "--lr") pruner.learningRate = std::stof(value);
+        else {
+            std::cerr << "Error: unknown option " << key << std::endl;
+            return 1;
+        }
+    }
+    if (pruner.keepRatio <= 0.0f || pruner.keepRatio > 1.0f) {
+        std::cerr << "Error: --keep must be in (0, 1]" << std::endl;
+        return 1;
+    }
+
+    NN::NeuralNetwork net;
+    if (!net.load(modelPath)) return 1;
+
+    std::cout << "Loading Data..." << std::endl;
+    auto trainingData = ImgProc::MnistLoader::load(basePath + "train-images.idx3-ubyte", basePath + "train-labels.idx1-ubyte");
+    auto testData = ImgProc::MnistLoader::load(basePath + "t10k-images.idx3-ubyte", basePath + "t10k-labels.idx1-ubyte");
+    if (trainingData.empty() || testData.empty()) return 1;
+
+    report("Original", net, testData);
+
+    // 1. Rank the hidden neurons on (a part of) the training set
+    std::vector<NN::NeuronStats> stats = pruner.analyze(net, trainingData);
+    if (stats.empty()) {
+        std::cerr << "Error: no dense hidden layer to prune in " << modelPath << std::endl;
+        return 1;
+    }
+    for (const NN::NeuronStats& s : stats) {
+        std::cout << "  layer " << s.layer << ": keeping " << pruner.selectNeurons(s).size()
+                  << " of " << s.score.size() << " neurons" << std::endl;
+    }
+
+    // 2. Rewrite the weight matrices, then optionally retrain briefly
+    NN::NeuralNetwork pruned = pruner.prune(net, stats);
+    report("Pruned", pruned, testData);
+    if (pruner.fineTuneEpochs > 0) {
+        pruner.fineTune(pruned, trainingData);
+        report("Fine-tuned", pruned, testData);
+    }
+
+    pruned.save(outPath);
+    return 0;
+}
@@ -0,0 +1,95 @@
+#include "../lib/network.h"
+#include "../lib/image_processing.h"
+#include "../lib/evaluator.h"
+#include "../lib/sweep.h"
+#include "../lib/cross_validation.h"
+#include "../lib/csv_loader.h"
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Hyperparameter sweep: loads MNIST once and trains every combination of learning rate,
+// hidden size and augmentation concurrently, culling with successive halving.
+//     ./sweep --budget 10000 --eta 3 --report sweep_report.csv
+// Cross-validation of one configuration instead (k folds trained in parallel):
+//     ./sweep --cv 5 --lr 0.1 --hidden 32 --augment 1 --samples 60000
+// Training data from a "label,p0,...,p783" CSV instead of the IDX files:
+//     ./sweep --train-csv mnist_train.csv
+
+int main(int argc, char** argv) {
+    // Update path !!!!!!!!!!!!!!!!!
+    std::string basePath = "/home/manuel/Projects/NeuralNetwok/dataset/MNIST_CSV/";
+    std::string reportPath = "sweep_report.csv";
+    std::string trainCsv;
+    size_t budget = 10000; // samples per config in the first rung
+    int eta = 3;           // keep 1/eta per rung, eta times the budget
+    size_t validationSize = 10000;
+    int folds = 0; // > 0: cross-validate `single` instead of sweeping
+    NN::SweepConfig single;
+    size_t samplesPerFold = 60000;
+
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string key = argv[i];
+        std::string value = argv[i + 1];
+        if (key == "--data") basePath = value;
+        else if (key == "--report") reportPath = value;
+        else if (key == "--train-csv") trainCsv = value;
+        else if (key == "--budget") budget = std::stoul(value);
+        else if (key == "--eta") eta = std::stoi(value);
+        else if (key == "--validation") validationSize = std::stoul(value);
+        else if (key == "--cv") folds = std::stoi(value);
+        else if (key == "--lr") single.learningRate = std::stof(value);
+        else if (key == "--hidden") single.hiddenSize = std::stoi(value);
+        else if (key == "--augment") single.augment = (value != "0");
+        else if (key == "--samples") samplesPerFold = std::stoul(value);
+        else {
+            std::cerr << "Error: unknown option " << key << std::endl;
+            return 1;
+        }
+    }
+
+    std::cout << "Loading Data..." << std::endl;
+    auto trainingData = trainCsv.empty()
+        ? ImgProc::MnistLoader::load(basePath + "train-images.idx3-ubyte", basePath + "train-labels.idx1-ubyte")
+        : ImgProc::CsvLoader::loadImages(trainCsv);
+    auto testData = ImgProc::MnistLoader::load(basePath + "t10k-images.idx3-ubyte", basePath + "t10k-labels.idx1-ubyte");
+    if (trainingData.empty() || testData.empty() || trainingData.size() <= validationSize) return 1;
+
+    if (folds > 0) {
+        std::cout << folds << "-fold cross-validation of " << single.name() << std::endl;
+        NN::CrossValidationResult cv = NN::crossValidate(trainingData, single, folds, samplesPerFold);
+        for (size_t f = 0; f < cv.folds.size(); f++) {
+            std::cout << "  fold " << f << ": " << cv.folds[f].accuracy() << "% (loss " << cv.folds[f].meanLoss() << ")" << std::endl;
+        }
+        std::cout << "Accuracy " << cv.meanAccuracy() << "% +/- " << cv.stddevAccuracy()
+                  << " (pooled " << cv.total.accuracy() << "% over " << cv.total.total << " samples)" << std::endl;
+        return cv.folds.empty() ? 1 : 0;
+    }
+
+    // Hold out the tail of the training set for ranking, keep the test set for the winner
+    std::vector<ImgProc::Image> validation(std::make_move_iterator(trainingData.end() - validationSize),
+                                           std::make_move_iterator(trainingData.end()));
+    trainingData.resize(trainingData.size() - validationSize);
+
+    std::vector<NN::SweepConfig> configs;
+    for (float lr : {0.01f, 0.05f, 0.1f}) {
+        for (int hidden : {32, 64, 128}) {
+            for (bool augment : {false, true}) {
+                NN::SweepConfig c;
+                c.learningRate = lr;
+                c.hiddenSize = hidden;
+                c.augment = augment;
+                configs.push_back(c);
+            }
+        }
+    }
+
+    NN::SweepRunner runner(trainingData, validation, budget, eta);
+    NN::Trial& best = runner.run(configs);
+    runner.writeReport(reportPath);
+
+    NN::EvalResult test = NN::evaluate(best.net, testData);
+    std::cout << "Best: " << best.config.name() << " -> test accuracy " << test.accuracy() << "%" << std::endl;
+    best.net.save("mnist_model.bin");
+    return 0;
+}
@@ -0,0 +1,59 @@
+#include "../lib/autodiff.h"
+#include "../lib/network.h"
+#include "test_util.h"
+
+// Tape gradients against central finite differences, and Tape::dense against Layer
+using namespace NN;
+
+struct Model {
+    Parameter W1{6, 5, 0.5f}, b1{1, 5, 0.5f}, W2{5, 4, 0.5f}, s{1, 4, 0.5f};
+
+    // Touches every op: input, param, add, mul, activation, matvec, dense, mse, softmax CE
+    Var loss(Tape& t, const std::vector<float>& x, const std::vector<float>& y) {
+        t.reset();
+        Var h = t.dense(t.input(x), W1, b1, ActivationType::Tanh);
+        Var z = t.matvec(h, W2);
+        Var z2 = t.add(t.mul(z, t.param(s)), z);
+        Var ce = t.softmaxCrossEntropy(t.activation(z2, ActivationType::LeakyReLU), y);
+        return t.add(ce, t.mse(z, y));
+    }
+};
+
+int main() {
+    bool ok = true;
+    Model m;
+    const std::vector<float> x = {0.1f, 0.0f, 0.3f, -0.7f, 0.9f, 0.2f};
+    const std::vector<float> y = Test::oneHot(4, 1);
+
+    // 1. Analytic gradients
+    Tape tape;
+    tape.backward(m.loss(tape, x, y));
+
+    // 2. Numeric gradients, one parameter entry at a time
+    float worst = 0.0f;
+    for (Parameter* p : {&m.W1, &m.b1, &m.W2, &m.s}) {
+        for (int i = 0; i < p->size(); i++) {
+            const float eps = 1e-3f, old = p->value[i];
+            Tape probe;
+            p->value[i] = old + eps;
+            float up = probe.value(m.loss(probe, x, y))[0];
+            p->value[i] = old - eps;
+            float down = probe.value(m.loss(probe, x, y))[0];
+            p->value[i] = old;
+            worst = std::max(worst, std::fabs((up - down) / (2 * eps) - p->grad[i]));
+        }
+    }
+    ok &= Test::expectNear(worst, 2e-3f, "tape gradients match finite differences");
+
+    // 3. Tape::dense runs the same kernel as Layer
+    Layer layer(6, 5, ActivationType::Tanh);
+    Parameter W(6, 5), b(1, 5);
+    W.value = layer.weights;
+    b.value = layer.biases;
+    tape.reset();
+    Var out = tape.dense(tape.input(x), W, b, ActivationType::Tanh);
+    std::vector<float> tapeOut(tape.value(out), tape.value(out) + tape.size(out));
+    ok &= Test::expectNear(Test::maxDiff(tapeOut, layer.infer(x)), 0.0f, "tape dense == Layer::infer");
+
+    return ok ? 0 : 1;
+}
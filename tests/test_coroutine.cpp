@@ -0,0 +1,55 @@
+#include "../lib/coroutine.h"
+#include "test_util.h"
+
+#include <memory>
+
+// CoroScheduler / Channel stress: short-lived schedulers on a multi-worker pool, each running
+// producers and consumers through a small channel. The scheduler is on the heap and deleted
+// right after run(), so a pool task that still touches it afterwards shows up under ASan.
+using namespace NN;
+
+static Task produce(CoroScheduler& s, Channel<int>& ch, int first, int count) {
+    co_await s.schedule();
+    for (int i = first; i < first + count; i++) co_await ch.send(i);
+    ch.close();
+}
+
+static Task consume(CoroScheduler& s, Channel<int>& ch, long& sum, int& received) {
+    co_await s.schedule();
+    while (auto v = co_await ch.receive()) {
+        sum += *v;
+        received++;
+    }
+}
+
+// `rounds` fresh schedulers on `pool`; returns how many rounds lost or duplicated items
+static int stress(ThreadPool& pool, int rounds) {
+    const int producers = 3, consumers = 2, perProducer = 200;
+    int wrong = 0;
+    for (int round = 0; round < rounds; round++) {
+        auto scheduler = std::make_unique<CoroScheduler>(pool);
+        Channel<int> channel(*scheduler, 2, producers);
+        long sums[consumers] = {};
+        int counts[consumers] = {};
+
+        for (int p = 0; p < producers; p++) produce(*scheduler, channel, p * perProducer, perProducer).spawn(*scheduler);
+        for (int c = 0; c < consumers; c++) consume(*scheduler, channel, sums[c], counts[c]).spawn(*scheduler);
+        scheduler->run();
+        scheduler.reset();
+
+        const long n = producers * perProducer;
+        if (counts[0] + counts[1] != n || sums[0] + sums[1] != n * (n - 1) / 2) wrong++;
+    }
+    return wrong;
+}
+
+int main() {
+    bool ok = true;
+    for (int workers : {4, 0}) { // 0: everything is resumed by the thread in run()
+        ThreadPool pool(workers);
+        int wrong = stress(pool, 300);
+        ok &= Test::expect(wrong == 0, std::to_string(workers) + " pool workers: every item delivered exactly once in 300 rounds (" +
+                                       std::to_string(wrong) + " wrong)");
+    }
+    return ok ? 0 : 1;
+}
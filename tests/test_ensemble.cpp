@@ -0,0 +1,50 @@
+#include "../lib/ensemble.h"
+#include "test_util.h"
+
+// FusedEnsemble against K independently trained NeuralNetworks
+using namespace NN;
+
+int main() {
+    bool ok = true;
+    const int K = 4;
+
+    for (auto topology : std::vector<std::vector<int>>{{40, 10}, {40, 24, 10}, {40, 24, 16, 10}}) {
+        std::vector<NeuralNetwork> nets;
+        for (int k = 0; k < K; k++) nets.emplace_back(topology);
+        FusedEnsemble ensemble(nets);
+
+        for (int step = 0; step < 200; step++) {
+            std::vector<float> x = Test::wave(40, 0.7f * step), t = Test::oneHot(10, step);
+            for (auto& net : nets) net.train(x, t, 0.05f);
+            ensemble.train(x, t, 0.05f);
+        }
+
+        // 1. Every member trained exactly like its separate copy
+        float memberDiff = 0.0f;
+        for (int k = 0; k < K; k++) {
+            NeuralNetwork member = ensemble.member(k);
+            for (int s = 0; s < 20; s++) {
+                std::vector<float> x = Test::wave(40, 1.1f * s);
+                memberDiff = std::max(memberDiff, Test::maxDiff(member.predict(x), nets[k].predict(x)));
+            }
+        }
+        const std::string name = std::to_string(topology.size() - 1) + " layer(s): ";
+        ok &= Test::expectNear(memberDiff, 0.0f, name + "member(k) == separately trained network");
+
+        // 2. predict / predictBatch are the mean of the members
+        std::vector<std::vector<float>> inputs;
+        for (int s = 0; s < 37; s++) inputs.push_back(Test::wave(40, 2.3f * s));
+        auto batch = ensemble.predictBatch(inputs);
+        float meanDiff = batch.size() == inputs.size() ? 0.0f : INFINITY;
+        for (size_t s = 0; s < batch.size(); s++) {
+            std::vector<float> mean(10, 0.0f);
+            for (auto& net : nets) {
+                auto p = net.predict(inputs[s]);
+                for (int o = 0; o < 10; o++) mean[o] += p[o] / K;
+            }
+            meanDiff = std::max({meanDiff, Test::maxDiff(ensemble.predict(inputs[s]), mean), Test::maxDiff(batch[s], mean)});
+        }
+        ok &= Test::expectNear(meanDiff, 1e-6f, name + "predict/predictBatch == mean of the members");
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,65 @@
+#include "../lib/memory_planner.h"
+#include "../lib/gradients.h"
+#include "test_util.h"
+
+// MemoryPlan packing, and PlannedTrainer against NeuralNetwork::train / a mean-gradient step
+using namespace NN;
+
+// Buffers that are alive at the same step must not share memory
+static bool planIsSound(const MemoryPlan& plan) {
+    for (size_t a = 0; a < plan.buffers.size(); a++) {
+        const auto& x = plan.buffers[a];
+        if (x.offset + x.size > plan.totalSize) return false;
+        for (size_t b = a + 1; b < plan.buffers.size(); b++) {
+            const auto& y = plan.buffers[b];
+            bool liveTogether = x.firstUse <= y.lastUse && y.firstUse <= x.lastUse;
+            bool shareMemory = x.offset < y.offset + y.size && y.offset < x.offset + x.size;
+            if (liveTogether && shareMemory) return false;
+        }
+    }
+    return true;
+}
+
+int main() {
+    bool ok = true;
+
+    // 1. Batch 1 is exactly NeuralNetwork::train (L1 included)
+    NeuralNetwork reference({20, 32, 32, 16, 4});
+    NeuralNetwork planned = reference;
+    PlannedTrainer trainer(planned, 1);
+    ok &= Test::expect(trainer.valid && planIsSound(trainer.plan), "batch-1 plan keeps live buffers apart");
+    for (int step = 0; step < 5; step++) {
+        std::vector<float> x = Test::wave(20, 0.5f * step), t = Test::oneHot(4, step);
+        reference.train(x, t, 0.1f, 0.001f);
+        trainer.trainBatch({x.data()}, {t.data()}, 0.1f, 0.001f);
+    }
+    ok &= Test::expectNear(Test::maxWeightDiff(reference, planned), 0.0f, "batch 1 == NeuralNetwork::train");
+
+    // 2. Batch B is one step down the mean gradient
+    const int B = 8;
+    NeuralNetwork meanStep({20, 32, 32, 16, 10});
+    NeuralNetwork batched = meanStep;
+    PlannedTrainer batchTrainer(batched, B);
+    ok &= Test::expect(planIsSound(batchTrainer.plan) && batchTrainer.plan.totalSize < batchTrainer.plan.naiveSize(),
+                       "batch plan is sound and smaller than one buffer each");
+
+    std::vector<std::vector<float>> xs, ts;
+    std::vector<const float*> inputs, targets;
+    for (int b = 0; b < B; b++) {
+        xs.push_back(Test::wave(20, 0.9f * b));
+        ts.push_back(Test::oneHot(10, b));
+    }
+    for (int b = 0; b < B; b++) {
+        inputs.push_back(xs[b].data());
+        targets.push_back(ts[b].data());
+    }
+    GradientBuffer grads(meanStep);
+    GradientScratch scratch(meanStep);
+    grads.zero();
+    for (int b = 0; b < B; b++) accumulateGradients(meanStep, inputs[b], targets[b], grads, scratch);
+    applyGradients(meanStep, grads.data.data(), 0.1f / B);
+    batchTrainer.trainBatch(inputs, targets, 0.1f);
+    ok &= Test::expectNear(Test::maxWeightDiff(meanStep, batched), 1e-6f, "batch 8 == mean-gradient SGD step");
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,31 @@
+#include "../lib/model_parallel.h"
+#include "test_util.h"
+
+// ModelParallelNetwork (wide layers split by output neuron) against NeuralNetwork::train
+using namespace NN;
+
+int main() {
+    bool ok = true;
+    NeuralNetwork reference({50, 5000, 3});
+    NeuralNetwork split = reference;
+    const std::vector<float> x = Test::wave(50, 0.2f, 0.1f), t = Test::oneHot(3, 1);
+
+    float outDiff = 0.0f;
+    {
+        ModelParallelNetwork mp(split, 4, 1000);
+        for (int step = 0; step < 4; step++) {
+            reference.train(x, t, 0.01f, 0.001f);
+            mp.train(x, t, 0.01f, 0.001f);
+        }
+        outDiff = Test::maxDiff(reference.feedForward(x), mp.feedForward(x));
+        mp.writeBack();
+    }
+    ok &= Test::expectNear(outDiff, 1e-5f, "partitioned training == NeuralNetwork::train");
+
+    // writeBack() hands the trained slices back to the plain network
+    const Layer& a = std::get<Layer>(reference.layers[0]);
+    const Layer& b = std::get<Layer>(split.layers[0]);
+    ok &= Test::expectNear(std::max(Test::maxDiff(a.weights, b.weights), Test::maxDiff(a.biases, b.biases)), 1e-6f,
+                           "writeBack restores the trained weights");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,49 @@
+#include "../lib/parallel_trainer.h"
+#include "../lib/gradients.h"
+#include "test_util.h"
+
+// accumulateGradients/applyGradients against NeuralNetwork::train, and one full-batch
+// DataParallelTrainer step against the same step taken serially
+using namespace NN;
+
+int main() {
+    bool ok = true;
+
+    // 1. One sample through the gradient buffer == NeuralNetwork::train
+    NeuralNetwork reference({30, 16, 10});
+    NeuralNetwork buffered = reference;
+    GradientBuffer grads(buffered);
+    GradientScratch scratch(buffered);
+    for (int step = 0; step < 5; step++) {
+        std::vector<float> x = Test::wave(30, 0.4f * step), t = Test::oneHot(10, step);
+        reference.train(x, t, 0.1f);
+        grads.zero();
+        accumulateGradients(buffered, x.data(), t.data(), grads, scratch);
+        applyGradients(buffered, grads.data.data(), 0.1f);
+    }
+    ok &= Test::expectNear(Test::maxWeightDiff(reference, buffered), 1e-6f, "accumulate + apply == NeuralNetwork::train");
+
+    // 2. A batch as big as the data set is one full-batch step, whatever the shuffle, the
+    //    thread count or the NUMA layout
+    const int N = 8;
+    std::vector<ImgProc::Image> data(N);
+    for (int i = 0; i < N; i++) {
+        data[i].pixels = Test::wave(30, 1.3f * i);
+        data[i].label = i % 10;
+        data[i].target = Test::oneHot(10, i);
+    }
+    for (int threads : {1, 2, 4}) {
+        NeuralNetwork serial({30, 16, 10});
+        NeuralNetwork parallel = serial;
+        grads.zero();
+        for (const auto& img : data) accumulateGradients(serial, img.pixels.data(), img.target.data(), grads, scratch);
+        applyGradients(serial, grads.data.data(), 0.5f / N);
+
+        DataParallelTrainer trainer(parallel, threads);
+        trainer.train(data, 1, N, 0.5f);
+        ok &= Test::expectNear(Test::maxWeightDiff(serial, parallel), 1e-5f,
+                               std::to_string(threads) + " thread(s) == serial full-batch step");
+    }
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,31 @@
+#include "../lib/pipeline.h"
+#include "test_util.h"
+
+// PipelineInference over a mixed network against NeuralNetwork::predict
+using namespace NN;
+
+int main() {
+    bool ok = true;
+    NeuralNetwork net;
+    net.addLayer(ConvLayer(1, 4, 28, 28, 3, ActivationType::ReLU));
+    net.addLayer(PoolLayer(4, 26, 26, 2, 2, PoolType::Max));
+    net.addLayer(Layer(676, 128, ActivationType::Tanh));
+    net.addLayer(NormLayer(128));
+    net.addLayer(Layer(128, 10, ActivationType::Sigmoid));
+
+    std::vector<std::vector<float>> inputs;
+    for (int i = 0; i < 300; i++) inputs.push_back(Test::wave(784, 0.3f * i));
+
+    for (int stages : {1, 3, 5}) {
+        PipelineInference pipeline(net, stages);
+        // Uneven micro-batches too: the last one is short
+        for (int micro : {16, 7}) {
+            auto outputs = pipeline.run(inputs, micro);
+            float worst = outputs.size() == inputs.size() ? 0.0f : INFINITY;
+            for (size_t i = 0; i < outputs.size(); i++) worst = std::max(worst, Test::maxDiff(outputs[i], net.predict(inputs[i])));
+            ok &= Test::expectNear(worst, 0.0f, std::to_string(pipeline.numStages()) + " stage(s), micro-batch " +
+                                                    std::to_string(micro) + " == predict, in order");
+        }
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <cmath>
+#include <iostream>
+#include <algorithm>
+
+#include "../lib/network.h"
+
+// Shared helpers for the equivalence checks in tests/ (run with `meson test`).
+// Inputs are deterministic waves, so a failure does not depend on a data set being present.
+namespace Test {
+
+    inline std::vector<float> wave(size_t n, float phase, float scale = 1.0f) {
+        std::vector<float> v(n);
+        for (size_t i = 0; i < n; i++) v[i] = scale * std::sin(0.37f * i + phase);
+        return v;
+    }
+
+    // One-hot target over `classes`
+    inline std::vector<float> oneHot(int classes, int label) {
+        std::vector<float> t(classes, 0.0f);
+        t[label % classes] = 1.0f;
+        return t;
+    }
+
+    inline float maxDiff(const std::vector<float>& a, const std::vector<float>& b) {
+        if (a.size() != b.size()) return INFINITY;
+        float m = 0.0f;
+        for (size_t i = 0; i < a.size(); i++) m = std::max(m, std::fabs(a[i] - b[i]));
+        return m;
+    }
+
+    // Largest weight or bias difference between two dense networks of the same topology
+    inline float maxWeightDiff(const NN::NeuralNetwork& a, const NN::NeuralNetwork& b) {
+        if (a.layers.size() != b.layers.size()) return INFINITY;
+        float m = 0.0f;
+        for (size_t i = 0; i < a.layers.size(); i++) {
+            const NN::Layer& x = std::get<NN::Layer>(a.layers[i]);
+            const NN::Layer& y = std::get<NN::Layer>(b.layers[i]);
+            m = std::max({m, maxDiff(x.weights, y.weights), maxDiff(x.biases, y.biases)});
+        }
+        return m;
+    }
+
+    // Prints the outcome of one check and returns it, so checks can be and-ed together
+    inline bool expect(bool ok, const std::string& what) {
+        std::cout << (ok ? "ok    " : "FAIL  ") << what << std::endl;
+        return ok;
+    }
+
+    inline bool expectNear(float diff, float tolerance, const std::string& what) {
+        return expect(diff <= tolerance, what + " (max diff " + std::to_string(diff) + ")");
+    }
+}